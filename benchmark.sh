@@ -0,0 +1,65 @@
+#!/bin/bash
+
+# Compare the options of the <server> node: the simulation runs headless once
+# per value of each swept attribute and the bulk RPCs of a drone are measured.
+# The other attributes keep the value of the experiment.
+# Usage: benchmark.sh [calls] [algorithms] [clients]
+#
+# The values of the other sweeps are read from the environment, an empty
+# list skips the sweep:
+#   KEEPALIVE_MS        keepalive_time_ms   (default: "1000 30000")
+#   MAX_POLLERS         max_pollers         (default: "0 1 4")
+#   MAX_THREADS         max_threads         (default: "0 4 16")
+#   RESOURCE_QUOTA_MB   resource_quota_mb   (default: "0 16 256")
+
+calls=${1:-1000}
+algorithms=${2:-"none gzip deflate"}
+clients=${3:-4}
+config=experiments/golden_run.argos
+output_dir=benchmark_output
+results=$output_dir/results.csv
+target=localhost:9854
+uri=fly0
+
+sweeps=(
+    "compression:$algorithms"
+    "keepalive_time_ms:${KEEPALIVE_MS-1000 30000}"
+    "max_pollers:${MAX_POLLERS-0 1 4}"
+    "max_threads:${MAX_THREADS-0 4 16}"
+    "resource_quota_mb:${RESOURCE_QUOTA_MB-0 16 256}"
+)
+
+mkdir -p $output_dir
+echo "attribute,value,rpc,calls_per_s,p50_us,p99_us,bytes_per_reply" > $results
+
+for sweep in "${sweeps[@]}"
+do
+    attribute=${sweep%%:*}
+    for value in ${sweep#*:}
+    do
+        name=${attribute}_$value
+        run_config=$output_dir/$name.argos
+
+        # Endless run so the server stays up while it is measured
+        sed -E -e "s/length=\"[^\"]*\"/length=\"0\"/" \
+            -e "s/ $attribute=\"[^\"]*\"/ $attribute=\"$value\"/" \
+            -e "s|output=\"[^\"]*\"|output=\"$output_dir/$name\"|" \
+            $config > $run_config
+
+        argos3 -c $run_config > $output_dir/$name.log 2>&1 &
+        simulation=$!
+        sleep 3
+
+        echo "==== $attribute $value ===="
+        build/benchmark/simulation_benchmark $target $uri $calls $clients |
+            tee $output_dir/$name.txt
+        awk -v prefix=$attribute,$value \
+            '{ print prefix "," $1 "," $2 "," $4 "," $7 "," $10 }' \
+            $output_dir/$name.txt >> $results
+
+        kill $simulation
+        wait $simulation 2>/dev/null
+    done
+done
+
+echo "Results written to $results"
@@ -0,0 +1,171 @@
+#include "allocation_counter.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <new>
+
+// Preloaded in front of the C and C++ libraries, every heap allocation of the
+// process goes through these definitions: the malloc family, used by gRPC
+// and the C libraries, and every operator new, aligned ones included.
+//     LD_PRELOAD=build/benchmark/libsimulation_allocation_counter.so argos3 ...
+
+// Allocations of glibc itself, the definitions below forward to them
+extern "C" void* __libc_malloc(std::size_t size);
+extern "C" void* __libc_calloc(std::size_t count, std::size_t size);
+extern "C" void* __libc_realloc(void* memory, std::size_t size);
+extern "C" void* __libc_memalign(std::size_t alignment, std::size_t size);
+
+// Counted per thread, so the simulation thread does not count the
+// allocations of the gRPC threads. Initial exec, so reading it never
+// allocates the thread local storage from inside malloc.
+static thread_local uint64_t allocations
+    __attribute__((tls_model("initial-exec"))) = 0;
+
+/// @brief Get the number of allocations of the calling thread since it
+/// started
+/// @return Number of allocations
+extern "C" uint64_t simulation_thread_allocation_count()
+{
+    return allocations;
+}
+
+extern "C" void* malloc(std::size_t size)
+{
+    ++allocations;
+    return __libc_malloc(size);
+}
+
+extern "C" void* calloc(std::size_t count, std::size_t size)
+{
+    ++allocations;
+    return __libc_calloc(count, size);
+}
+
+extern "C" void* realloc(void* memory, std::size_t size)
+{
+    ++allocations;
+    return __libc_realloc(memory, size);
+}
+
+extern "C" void* memalign(std::size_t alignment, std::size_t size)
+{
+    ++allocations;
+    return __libc_memalign(alignment, size);
+}
+
+extern "C" void* aligned_alloc(std::size_t alignment, std::size_t size)
+{
+    return memalign(alignment, size);
+}
+
+extern "C" int posix_memalign(
+    void** memory, std::size_t alignment, std::size_t size)
+{
+    if (alignment % sizeof(void*) != 0 ||
+        (alignment & (alignment - 1)) != 0)
+    {
+        return EINVAL;
+    }
+
+    void* allocated = memalign(alignment, size);
+    if (allocated == nullptr)
+    {
+        return ENOMEM;
+    }
+
+    *memory = allocated;
+    return 0;
+}
+
+/// @brief Make an allocation for operator new, counted by malloc
+/// @param size Size, in bytes
+/// @param alignment Alignment, 0 for the default one
+/// @return Allocated memory, nullptr if there is no memory left
+static void* allocate(std::size_t size, std::size_t alignment)
+{
+    if (size == 0)
+    {
+        size = 1;
+    }
+    return alignment == 0 ? malloc(size) : memalign(alignment, size);
+}
+
+/// @brief Make an allocation for operator new, or throw
+/// @param size Size, in bytes
+/// @param alignment Alignment, 0 for the default one
+/// @return Allocated memory
+static void* allocateOrThrow(std::size_t size, std::size_t alignment)
+{
+    void* memory = allocate(size, alignment);
+    if (memory == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+void* operator new(std::size_t size) { return allocateOrThrow(size, 0); }
+
+void* operator new[](std::size_t size) { return allocateOrThrow(size, 0); }
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    return allocate(size, 0);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    return allocate(size, 0);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    return allocateOrThrow(size, static_cast<std::size_t>(alignment));
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+    return allocateOrThrow(size, static_cast<std::size_t>(alignment));
+}
+
+void* operator new(
+    std::size_t size, std::align_val_t alignment,
+    const std::nothrow_t&) noexcept
+{
+    return allocate(size, static_cast<std::size_t>(alignment));
+}
+
+void* operator new[](
+    std::size_t size, std::align_val_t alignment,
+    const std::nothrow_t&) noexcept
+{
+    return allocate(size, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void* memory) noexcept { free(memory); }
+
+void operator delete[](void* memory) noexcept { free(memory); }
+
+void operator delete(void* memory, std::size_t) noexcept { free(memory); }
+
+void operator delete[](void* memory, std::size_t) noexcept { free(memory); }
+
+void operator delete(void* memory, std::align_val_t) noexcept
+{
+    free(memory);
+}
+
+void operator delete[](void* memory, std::align_val_t) noexcept
+{
+    free(memory);
+}
+
+void operator delete(void* memory, std::size_t, std::align_val_t) noexcept
+{
+    free(memory);
+}
+
+void operator delete[](void* memory, std::size_t, std::align_val_t) noexcept
+{
+    free(memory);
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <cstdint>
+
+// Number of heap allocations made by the calling thread since it started,
+// through the malloc family or operator new. Defined by the allocation
+// counter library when it is preloaded with LD_PRELOAD, the weak declaration
+// is null otherwise.
+extern "C" uint64_t simulation_thread_allocation_count()
+    __attribute__((weak));
@@ -0,0 +1,170 @@
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <grpcpp/grpcpp.h>
+
+#include "simulation.grpc.pb.h"
+
+using simulation::DistancesReply;
+using simulation::FrameReply;
+using simulation::FrameRequest;
+using simulation::HistoryRequest;
+using simulation::Simulation;
+using simulation::TelemetricsReply;
+
+using Clock = std::chrono::steady_clock;
+
+/// @brief Time a number of calls of a RPC and print the throughput, the
+/// latency percentiles and the size of the replies
+/// @param name Name of the RPC
+/// @param calls Number of calls
+/// @param clients Number of threads making the calls at the same time
+/// @param call Makes a single call and returns the size of the reply
+/// @return false if a call failed
+bool measure(
+    const std::string& name, int calls, int clients,
+    const std::function<long(void)>& call)
+{
+    std::vector<double> latencies;
+    latencies.reserve(calls);
+    long bytes = 0;
+    bool failed = false;
+    std::mutex mutex;
+
+    auto run = [&](int clientCalls)
+    {
+        std::vector<double> clientLatencies;
+        clientLatencies.reserve(clientCalls);
+        long clientBytes = 0;
+        for (int i = 0; i < clientCalls; i++)
+        {
+            auto before = Clock::now();
+            long size = call();
+            if (size < 0)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                failed = true;
+                return;
+            }
+            clientBytes += size;
+            clientLatencies.push_back(
+                std::chrono::duration<double, std::micro>(
+                    Clock::now() - before)
+                    .count());
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        latencies.insert(
+            latencies.end(), clientLatencies.begin(), clientLatencies.end());
+        bytes += clientBytes;
+    };
+
+    auto start = Clock::now();
+    std::vector<std::thread> threads;
+    for (int client = 0; client < clients; client++)
+    {
+        threads.emplace_back(
+            run, calls / clients + (client < calls % clients ? 1 : 0));
+    }
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+    double seconds =
+        std::chrono::duration<double>(Clock::now() - start).count();
+
+    if (failed || latencies.empty())
+    {
+        std::cerr << name << " failed after " << latencies.size() << " calls"
+                  << std::endl;
+        return false;
+    }
+    calls = latencies.size();
+
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&latencies](double p)
+    { return latencies[static_cast<size_t>(p * (latencies.size() - 1))]; };
+
+    std::cout << std::fixed << std::setprecision(1) << std::left
+              << std::setw(16) << name << std::right << std::setw(10)
+              << calls / seconds << " calls/s" << std::setw(10)
+              << percentile(0.5) << " us p50" << std::setw(10)
+              << percentile(0.99) << " us p99" << std::setw(10)
+              << bytes / static_cast<double>(calls) << " B/reply"
+              << std::endl;
+    return true;
+}
+
+/// @brief Measure the bulk RPCs of a running simulation server, so the
+/// options of the <server> node can be compared. The clients share one
+/// channel, so the threads of the server are what limits them.
+/// Usage: simulation_benchmark <host:port> <uri> [calls] [clients]
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        std::cerr << "Usage: " << argv[0]
+                  << " <host:port> <uri> [calls] [clients]" << std::endl;
+        return 1;
+    }
+
+    std::string target = argv[1];
+    std::string uri = argv[2];
+    int calls = argc > 3 ? std::stoi(argv[3]) : 1000;
+    int clients = argc > 4 ? std::max(1, std::stoi(argv[4])) : 1;
+
+    grpc::ChannelArguments arguments;
+    arguments.SetMaxReceiveMessageSize(-1);
+
+    auto channel = grpc::CreateCustomChannel(
+        target, grpc::InsecureChannelCredentials(), arguments);
+    std::unique_ptr<Simulation::Stub> stub = Simulation::NewStub(channel);
+
+    // The whole history is read at every call, like a client joining late
+    HistoryRequest request;
+    request.set_uri(uri);
+    request.set_cursor(0);
+
+    bool success = true;
+    success &= measure(
+        "GetTelemetrics", calls, clients,
+        [&]()
+        {
+            grpc::ClientContext context;
+            TelemetricsReply reply;
+            return stub->GetTelemetrics(&context, request, &reply).ok()
+                       ? static_cast<long>(reply.ByteSizeLong())
+                       : -1;
+        });
+    success &= measure(
+        "GetDistances", calls, clients,
+        [&]()
+        {
+            grpc::ClientContext context;
+            DistancesReply reply;
+            return stub->GetDistances(&context, request, &reply).ok()
+                       ? static_cast<long>(reply.ByteSizeLong())
+                       : -1;
+        });
+    success &= measure(
+        "GetSwarmFrame", calls, clients,
+        [&]()
+        {
+            grpc::ClientContext context;
+            FrameRequest frameRequest;
+            FrameReply reply;
+            return stub->GetSwarmFrame(&context, frameRequest, &reply).ok()
+                       ? static_cast<long>(reply.ByteSizeLong())
+                       : -1;
+        });
+
+    return success ? 0 : 1;
+}
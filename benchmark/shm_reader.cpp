@@ -0,0 +1,62 @@
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <communication/shm_ring.h>
+
+using Clock = std::chrono::steady_clock;
+
+/// @brief Read samples from the shared memory ring of a running simulation
+/// and print the latency between their writing and their reading
+/// Usage: simulation_shm_reader [name] [samples]
+int main(int argc, char** argv)
+{
+    std::string name = argc > 1 ? argv[1] : "/inf3995_simulation";
+    size_t samples = argc > 2 ? std::stoul(argv[2]) : 10000;
+
+    ShmRingReader reader;
+    if (!reader.Open(name))
+    {
+        std::cerr << "No shared memory " << name
+                  << ", is the <shm> node set in the loop functions?"
+                  << std::endl;
+        return 1;
+    }
+
+    std::vector<double> latencies;
+    latencies.reserve(samples);
+    WireSample buffer[256];
+
+    while (latencies.size() < samples)
+    {
+        size_t count = reader.Read(buffer, 256);
+        uint64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                           Clock::now().time_since_epoch())
+                           .count();
+        for (size_t i = 0; i < count && latencies.size() < samples; ++i)
+        {
+            latencies.push_back((now - buffer[i].timestamp_ns) / 1000.0);
+        }
+
+        if (count == 0)
+        {
+            // Busy waiting would measure the scheduler rather than the ring
+            std::this_thread::yield();
+        }
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&latencies](double p)
+    { return latencies[static_cast<size_t>(p * (latencies.size() - 1))]; };
+
+    std::cout << std::fixed << std::setprecision(1) << samples
+              << " samples, p50 " << percentile(0.5) << " us, p99 "
+              << percentile(0.99) << " us, " << reader.GetLost() << " lost"
+              << std::endl;
+
+    return 0;
+}
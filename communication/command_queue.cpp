@@ -0,0 +1,113 @@
+#include "command_queue.h"
+
+#include <algorithm>
+
+/// @brief Constructor of the CommandQueue
+CommandQueue::CommandQueue()
+    : m_command_pending(false), m_next_ticket(1)
+{
+}
+
+/// @brief Add a command to the queue, a return command also waits for the
+/// drone to be back to base
+/// @param command Command to execute
+/// @return Ticket of the return, 0 for the other commands
+uint64_t CommandQueue::Push(Command command)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    uint64_t ticket = 0;
+    if (command.action == Action::Return)
+    {
+        ticket = m_next_ticket++;
+        m_returns_pending.push_back(ticket);
+    }
+    m_commands.push(std::move(command));
+    m_command_pending = true;
+
+    return ticket;
+}
+
+/// @brief Get the next command of the queue
+/// @param command Command that is next in queue
+/// @return True if could find next command, False if no command next
+bool CommandQueue::Pop(Command* command)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (m_commands.empty())
+    {
+        return false;
+    }
+
+    *command = std::move(m_commands.front());
+    m_commands.pop();
+    m_command_pending = !m_commands.empty();
+
+    return true;
+}
+
+/// @brief Check if a command is waiting, without taking the lock
+/// @return True if Pop has a command to give
+bool CommandQueue::HasCommand() const { return m_command_pending; }
+
+/// @brief Drop the queued commands, the returns waiting are told the drone
+/// will not arrive
+void CommandQueue::Clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_commands = std::queue<Command>();
+    m_command_pending = false;
+    EndReturns(false);
+}
+
+/// @brief Mark that the drone is back to base, for every return waiting
+void CommandQueue::Done()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    EndReturns(true);
+}
+
+/// @brief Take the end of a return if it ended
+/// @param ticket Ticket given by Push
+/// @param arrived Set to True if the drone arrived, False if its return was
+/// cancelled by an emergency stop
+/// @return True if the return ended, False if not
+bool CommandQueue::TakeDone(uint64_t ticket, bool* arrived)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto done = m_returns_done.find(ticket);
+    if (done == m_returns_done.end())
+    {
+        return false;
+    }
+
+    *arrived = done->second;
+    m_returns_done.erase(done);
+    return true;
+}
+
+/// @brief Forget a return whose request gave up, whether it ended or not
+/// @param ticket Ticket given by Push
+void CommandQueue::CancelReturn(uint64_t ticket)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_returns_pending.erase(
+        std::remove(m_returns_pending.begin(), m_returns_pending.end(), ticket),
+        m_returns_pending.end());
+    m_returns_done.erase(ticket);
+}
+
+/// @brief End every return waiting, the lock must be held
+/// @param arrived Whether the drone arrived
+void CommandQueue::EndReturns(bool arrived)
+{
+    for (uint64_t ticket : m_returns_pending)
+    {
+        m_returns_done[ticket] = arrived;
+    }
+    m_returns_pending.clear();
+}
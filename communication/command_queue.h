@@ -0,0 +1,40 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <queue>
+#include <vector>
+
+#include <struct/command.h>
+
+/// Commands sent to a drone, and the return requests waiting for it. Each
+/// return gets its own ticket, so a done is only taken by the request that
+/// asked for it, and a request that gives up leaves nothing behind.
+class CommandQueue final
+{
+public:
+    CommandQueue();
+
+    uint64_t Push(Command command);
+    bool Pop(Command* command);
+    bool HasCommand() const;
+    void Clear();
+    void Done();
+    bool TakeDone(uint64_t ticket, bool* arrived);
+    void CancelReturn(uint64_t ticket);
+
+private:
+    void EndReturns(bool arrived);
+
+    std::mutex m_mutex;
+    std::queue<Command> m_commands;
+    std::atomic<bool> m_command_pending;
+
+    // Tickets of the returns waiting for the drone, and the returns that
+    // ended but were not taken yet
+    uint64_t m_next_ticket;
+    std::vector<uint64_t> m_returns_pending;
+    std::map<uint64_t, bool> m_returns_done;
+};
@@ -0,0 +1,51 @@
+#include "coverage_board.h"
+
+/* Samples kept in the history, 262144 samples of 8 bytes */
+static const size_t HISTORY_SEGMENT_SIZE = 256;
+static const size_t HISTORY_SEGMENTS = 1024;
+
+/// @brief Constructor of the CoverageBoard
+CoverageBoard::CoverageBoard()
+    : m_history(HISTORY_SEGMENT_SIZE, HISTORY_SEGMENTS)
+{
+}
+
+/// @brief Get the board shared by the loop functions and the servers
+/// @return Board instance
+CoverageBoard& CoverageBoard::GetInstance()
+{
+    static CoverageBoard instance;
+    return instance;
+}
+
+/// @brief Replace the latest report, readers keep the one they already hold
+/// @param report New report
+void CoverageBoard::Publish(std::shared_ptr<const CoverageReport> report)
+{
+    std::atomic_store(&m_report, std::move(report));
+}
+
+/// @brief Get the latest report
+/// @return Latest report, null if none was published yet
+std::shared_ptr<const CoverageReport> CoverageBoard::Get() const
+{
+    return std::atomic_load(&m_report);
+}
+
+/// @brief Add the covered area of a sampled tick to the history
+/// @param point Sample to add
+void CoverageBoard::AppendHistory(const CoveragePoint& point)
+{
+    m_history.Append(point);
+}
+
+/// @brief Drop the history when the simulation is reset, the cursors of the
+/// clients stay valid
+void CoverageBoard::ClearHistory() { m_history.Clear(); }
+
+/// @brief Get the covered area over time
+/// @return History, read with a cursor
+const SegmentedLog<CoveragePoint>& CoverageBoard::GetHistory() const
+{
+    return m_history;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <memory>
+
+#include <struct/coverage.h>
+
+#include "segmented_log.h"
+
+/// Latest coverage report of the simulation, shared by every server, and the
+/// covered area over time. The history is only appended to, so the servers
+/// read it with a cursor instead of getting a copy with every report.
+class CoverageBoard final
+{
+public:
+    static CoverageBoard& GetInstance();
+
+    void Publish(std::shared_ptr<const CoverageReport> report);
+    std::shared_ptr<const CoverageReport> Get() const;
+
+    void AppendHistory(const CoveragePoint& point);
+    void ClearHistory();
+    const SegmentedLog<CoveragePoint>& GetHistory() const;
+
+private:
+    CoverageBoard();
+    CoverageBoard(const CoverageBoard&) = delete;
+    CoverageBoard& operator=(const CoverageBoard&) = delete;
+
+    std::shared_ptr<const CoverageReport> m_report;
+    SegmentedLog<CoveragePoint> m_history;
+};
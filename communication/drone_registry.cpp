@@ -0,0 +1,213 @@
+#include "drone_registry.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <thread>
+
+#include "server.h"
+
+/* Highest port a drone can use */
+static const unsigned int MAX_PORT = 65535;
+
+/// @brief Get the registry shared by every drone of the simulation
+/// @return Registry instance
+DroneRegistry& DroneRegistry::GetInstance()
+{
+    static DroneRegistry instance;
+    return instance;
+}
+
+/// @brief Assign a slot to a drone, registering the same uri twice returns
+/// the same slot
+/// @param uri Full entity id of the drone
+/// @param basePort Port of the drone in slot 0
+/// @param server Server of the drone, used by group commands
+/// @return Port assigned to the drone, 0 if no port is left
+unsigned int DroneRegistry::Register(
+    const std::string& uri, unsigned int basePort, SimulationServer* server)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto existing = m_drones.find(uri);
+    if (existing != m_drones.end())
+    {
+        m_servers[uri] = server;
+        return existing->second.port;
+    }
+
+    // The numeric suffix of the id is used when it is free and its port is
+    // valid, so "fly10" keeps port base + 10. Other ids take the first free
+    // slot.
+    bool found = false;
+    unsigned int slot = PreferredSlot(uri, &found);
+    if (!found || m_usedSlots.count(slot) != 0 || basePort + slot > MAX_PORT)
+    {
+        slot = 0;
+        while (m_usedSlots.count(slot) != 0)
+        {
+            ++slot;
+        }
+    }
+
+    if (basePort + slot > MAX_PORT)
+    {
+        return 0;
+    }
+
+    m_usedSlots.insert(slot);
+    m_drones[uri] = DroneEndpoint{uri, slot, basePort + slot};
+    m_servers[uri] = server;
+
+    return basePort + slot;
+}
+
+/// @brief Release the slot of a drone
+/// @param uri Full entity id of the drone
+void DroneRegistry::Unregister(const std::string& uri)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto drone = m_drones.find(uri);
+    if (drone == m_drones.end())
+    {
+        return;
+    }
+
+    m_usedSlots.erase(drone->second.slot);
+    m_drones.erase(drone);
+    m_servers.erase(uri);
+}
+
+/// @brief Get the endpoints of every registered drone
+/// @return Endpoints ordered by uri
+std::vector<DroneEndpoint> DroneRegistry::GetDrones()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    std::vector<DroneEndpoint> drones;
+    drones.reserve(m_drones.size());
+    for (const auto& drone : m_drones)
+    {
+        drones.push_back(drone.second);
+    }
+
+    return drones;
+}
+
+/// @brief Get the uri of every registered drone
+/// @return Uris in order
+std::vector<std::string> DroneRegistry::GetUris()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    std::vector<std::string> uris;
+    uris.reserve(m_drones.size());
+    for (const auto& drone : m_drones)
+    {
+        uris.push_back(drone.first);
+    }
+
+    return uris;
+}
+
+/// @brief Start the servers of every registered drone that are not running
+/// yet, on several threads since each server binds its port and spawns its
+/// own threads
+/// @param threads Number of threads starting servers
+/// @return Uris of the drones whose server could not start
+std::vector<std::string> DroneRegistry::StartServers(unsigned int threads)
+{
+    // The servers are started without the lock, so the group commands and
+    // the other drones are not blocked while every server binds its port
+    std::vector<std::pair<std::string, SimulationServer*>> servers;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        servers.assign(m_servers.begin(), m_servers.end());
+    }
+    std::vector<char> started(servers.size(), 0);
+    std::atomic<size_t> next(0);
+
+    auto startNext = [&]()
+    {
+        for (size_t i = next++; i < servers.size(); i = next++)
+        {
+            started[i] = servers[i].second->Start();
+        }
+    };
+
+    threads = std::max(1u, std::min<unsigned int>(threads, servers.size()));
+    std::vector<std::thread> workers;
+    for (unsigned int i = 1; i < threads; ++i)
+    {
+        workers.emplace_back(startNext);
+    }
+    startNext();
+    for (std::thread& worker : workers)
+    {
+        worker.join();
+    }
+
+    std::vector<std::string> failed;
+    for (size_t i = 0; i < servers.size(); ++i)
+    {
+        if (!started[i])
+        {
+            failed.push_back(servers[i].first);
+        }
+    }
+
+    return failed;
+}
+
+/// @brief Wake up the group commands waiting for a drone to be done
+void DroneRegistry::NotifyDone()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_doneMutex);
+        ++m_doneGeneration;
+    }
+    m_doneCondition.notify_all();
+}
+
+/// @brief Get the number of done notifications so far
+/// @return Generation to pass to WaitForDone
+unsigned long DroneRegistry::GetDoneGeneration()
+{
+    std::lock_guard<std::mutex> lock(m_doneMutex);
+    return m_doneGeneration;
+}
+
+/// @brief Wait until a drone is done after the given generation
+/// @param generation Generation read before checking the drones
+/// @param timeout Maximum time to wait
+void DroneRegistry::WaitForDone(
+    unsigned long generation, std::chrono::milliseconds timeout)
+{
+    std::unique_lock<std::mutex> lock(m_doneMutex);
+    m_doneCondition.wait_for(
+        lock, timeout, [&] { return m_doneGeneration != generation; });
+}
+
+/// @brief Parse the numeric suffix of a drone id
+/// @param uri Full entity id of the drone
+/// @param found Set to True if the id ends with a number
+/// @return Number at the end of the id
+unsigned int DroneRegistry::PreferredSlot(const std::string& uri, bool* found)
+{
+    size_t start = uri.length();
+    while (start > 0 &&
+           std::isdigit(static_cast<unsigned char>(uri[start - 1])))
+    {
+        --start;
+    }
+
+    // Suffixes too long to be a slot are treated as non-numeric
+    *found = start < uri.length() && uri.length() - start <= 5;
+    if (!*found)
+    {
+        return 0;
+    }
+
+    return static_cast<unsigned int>(std::stoul(uri.substr(start)));
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+class SimulationServer;
+
+struct DroneEndpoint
+{
+    std::string uri;
+    unsigned int slot;
+    unsigned int port;
+};
+
+/// Process-wide registry assigning a unique slot (and port) to every drone
+class DroneRegistry final
+{
+public:
+    static DroneRegistry& GetInstance();
+
+    unsigned int Register(
+        const std::string& uri, unsigned int basePort,
+        SimulationServer* server);
+    void Unregister(const std::string& uri);
+    std::vector<DroneEndpoint> GetDrones();
+    std::vector<std::string> GetUris();
+    std::vector<std::string> StartServers(unsigned int threads);
+
+    /// Call function with the server of a drone, under the registry lock so
+    /// the server cannot be unregistered meanwhile
+    template <typename Function>
+    bool WithServer(const std::string& uri, Function function)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        auto server = m_servers.find(uri);
+        if (server == m_servers.end())
+        {
+            return false;
+        }
+
+        function(*server->second);
+        return true;
+    }
+
+    void NotifyDone();
+    unsigned long GetDoneGeneration();
+    void
+    WaitForDone(unsigned long generation, std::chrono::milliseconds timeout);
+
+private:
+    DroneRegistry() = default;
+    DroneRegistry(const DroneRegistry&) = delete;
+    DroneRegistry& operator=(const DroneRegistry&) = delete;
+
+    unsigned int PreferredSlot(const std::string& uri, bool* found);
+
+    std::mutex m_mutex;
+    std::map<std::string, DroneEndpoint> m_drones;
+    std::map<std::string, SimulationServer*> m_servers;
+    std::set<unsigned int> m_usedSlots;
+
+    std::mutex m_doneMutex;
+    std::condition_variable m_doneCondition;
+    unsigned long m_doneGeneration = 0;
+};
@@ -0,0 +1,28 @@
+#include "frame_board.h"
+
+/// @brief Get the board shared by the loop functions and the servers
+/// @return Board instance
+FrameBoard& FrameBoard::GetInstance()
+{
+    static FrameBoard instance;
+    return instance;
+}
+
+/// @brief Replace the latest frame, readers keep the one they already hold
+/// @param frame Frame of the tick that just ended
+void FrameBoard::Publish(std::shared_ptr<const TickFrame> frame)
+{
+    std::atomic_store(&m_frame, std::move(frame));
+}
+
+/// @brief Get the latest frame
+/// @return Latest frame, null before the first tick
+std::shared_ptr<const TickFrame> FrameBoard::Get() const
+{
+    return std::atomic_load(&m_frame);
+}
+
+/// @brief Get the subscriptions to the samples of every drone, the servers
+/// publish the samples of their drone to it
+/// @return Hub of the swarm
+SubscriptionHub& FrameBoard::GetHub() { return m_hub; }
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <memory>
+
+#include <struct/tick_frame.h>
+
+#include "subscription_hub.h"
+
+/// Latest state of the whole swarm, replaced once per tick, and the
+/// subscriptions to the samples of every drone
+class FrameBoard final
+{
+public:
+    static FrameBoard& GetInstance();
+
+    void Publish(std::shared_ptr<const TickFrame> frame);
+    std::shared_ptr<const TickFrame> Get() const;
+    SubscriptionHub& GetHub();
+
+private:
+    FrameBoard() = default;
+    FrameBoard(const FrameBoard&) = delete;
+    FrameBoard& operator=(const FrameBoard&) = delete;
+
+    std::shared_ptr<const TickFrame> m_frame;
+    SubscriptionHub m_hub;
+};
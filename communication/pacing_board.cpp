@@ -0,0 +1,28 @@
+#include "pacing_board.h"
+
+/// @brief Get the board shared by the loop functions and the servers
+/// @return Board instance
+PacingBoard& PacingBoard::GetInstance()
+{
+    static PacingBoard instance;
+    return instance;
+}
+
+/// @brief Replace the latest report
+/// @param report Report of the tick that just ended
+void PacingBoard::Publish(const PacingReport& report)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_report = report;
+    m_published = true;
+}
+
+/// @brief Get the latest report
+/// @param report Set to the latest report
+/// @return False before the first tick
+bool PacingBoard::Get(PacingReport* report) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    *report = m_report;
+    return m_published;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <mutex>
+
+#include <struct/pacing.h>
+
+/// Latest pacing report of the simulation, shared by every server. The
+/// report is copied under a lock so publishing it every tick does not
+/// allocate.
+class PacingBoard final
+{
+public:
+    static PacingBoard& GetInstance();
+
+    void Publish(const PacingReport& report);
+    bool Get(PacingReport* report) const;
+
+private:
+    PacingBoard() = default;
+    PacingBoard(const PacingBoard&) = delete;
+    PacingBoard& operator=(const PacingBoard&) = delete;
+
+    mutable std::mutex m_mutex;
+    PacingReport m_report;
+    bool m_published = false;
+};
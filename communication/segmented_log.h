@@ -0,0 +1,164 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/// Append-only history of the samples of a drone. Every sample gets a
+/// sequence number and is read without being removed, so any number of
+/// clients can follow the history with their own cursor. The history is
+/// kept in fixed size segments and the oldest segment is dropped once the
+/// retention limit is reached.
+template <typename T> class SegmentedLog final
+{
+public:
+    SegmentedLog(size_t segmentSize = 256, size_t maxSegments = 64)
+        : m_segmentSize(segmentSize), m_maxSegments(maxSegments),
+          m_nextSequence(0)
+    {
+    }
+
+    /// @brief Change the retention of the log, must be called before the
+    /// first sample is appended
+    /// @param segmentSize Number of samples per segment
+    /// @param maxSegments Number of segments kept
+    void Configure(size_t segmentSize, size_t maxSegments)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_segmentSize = segmentSize > 0 ? segmentSize : 1;
+        m_maxSegments = maxSegments > 0 ? maxSegments : 1;
+    }
+
+    /// @brief Add a sample at the end of the log
+    /// @param value Sample to add
+    /// @return Sequence number of the sample
+    uint64_t Append(const T& value)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if (m_segments.empty() ||
+            m_nextSequence - m_segments.back()->first == m_segmentSize)
+        {
+            std::shared_ptr<Segment> segment;
+            if (m_segments.size() == m_maxSegments)
+            {
+                // Readers still holding the segment keep it alive, otherwise
+                // its memory is reused for the new one
+                if (m_segments.front().use_count() == 1 &&
+                    m_segments.front()->entries.size() == m_segmentSize)
+                {
+                    // The count is read relaxed, the reads of the last
+                    // reader that released the segment must happen before
+                    // it is written again
+                    std::atomic_thread_fence(std::memory_order_acquire);
+                    segment = std::move(m_segments.front());
+                    segment->first = m_nextSequence;
+                }
+                m_segments.pop_front();
+            }
+            if (!segment)
+            {
+                segment =
+                    std::make_shared<Segment>(m_nextSequence, m_segmentSize);
+            }
+            m_segments.push_back(std::move(segment));
+        }
+
+        Segment& segment = *m_segments.back();
+        segment.entries[m_nextSequence - segment.first] = value;
+
+        return m_nextSequence++;
+    }
+
+    /// @brief Read the samples from a cursor without removing them
+    /// @param cursor Sequence number of the first sample to read, samples
+    /// already dropped by the retention are skipped
+    /// @param limit Maximum number of samples read (0: no limit)
+    /// @param visit Called with the sequence number and each sample
+    /// @return Cursor of the next sample to read
+    template <typename Visit>
+    uint64_t Read(uint64_t cursor, size_t limit, Visit visit) const
+    {
+        std::vector<std::shared_ptr<const Segment>> segments;
+        uint64_t end;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            end = m_nextSequence;
+            if (m_segments.empty() || cursor >= end)
+            {
+                return end > cursor ? end : cursor;
+            }
+
+            for (const std::shared_ptr<Segment>& segment : m_segments)
+            {
+                if (segment->first + segment->entries.size() > cursor)
+                {
+                    segments.push_back(segment);
+                }
+            }
+        }
+
+        if (cursor < segments.front()->first)
+        {
+            cursor = segments.front()->first;
+        }
+        if (limit > 0 && end - cursor > limit)
+        {
+            end = cursor + limit;
+        }
+
+        // Samples before the end taken under the lock are never written
+        // again, they are read without holding it
+        for (const std::shared_ptr<const Segment>& segment : segments)
+        {
+            uint64_t last = segment->first + segment->entries.size();
+            for (; cursor < last && cursor < end; ++cursor)
+            {
+                visit(cursor, segment->entries[cursor - segment->first]);
+            }
+        }
+
+        return cursor;
+    }
+
+    /// @brief Drop every sample. The sequence numbers keep growing, so the
+    /// cursors of the readers stay valid and only see the new samples
+    void Clear()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_segments.clear();
+    }
+
+    /// @brief Get the sequence number of the oldest sample still kept
+    uint64_t FirstSequence() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_segments.empty() ? m_nextSequence : m_segments.front()->first;
+    }
+
+    /// @brief Get the sequence number the next sample will have
+    uint64_t NextSequence() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_nextSequence;
+    }
+
+private:
+    struct Segment
+    {
+        Segment(uint64_t first, size_t size) : first(first), entries(size) {}
+
+        uint64_t first;
+        std::vector<T> entries;
+    };
+
+    mutable std::mutex m_mutex;
+    size_t m_segmentSize;
+    size_t m_maxSegments;
+    uint64_t m_nextSequence;
+    std::deque<std::shared_ptr<Segment>> m_segments;
+};
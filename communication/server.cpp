@@ -1,23 +1,62 @@
 #include "server.h"
 
+/// @brief Initialize the global state of gRPC, once for the whole process
+/// instead of once per drone
+static void initGrpc()
+{
+    static std::once_flag initialized;
+    std::call_once(
+        initialized,
+        []()
+        {
+            grpc::EnableDefaultHealthCheckService(true);
+            grpc::reflection::InitProtoReflectionServerBuilderPlugin();
+        });
+}
+
 /// @brief Constructor of the SimulationServer
 SimulationServer::SimulationServer()
-    : m_service(
-          m_queue_mutex, m_queue_command, m_queue_done, m_queue_metric,
-          m_queue_distance, m_queue_log)
+    : m_emergency_stop(false),
+      m_service(
+          m_commands, m_history_metric, m_history_distance, m_history_log,
+          m_emergency_stop, m_options, m_hub)
 {
-    grpc::EnableDefaultHealthCheckService(true);
-    grpc::reflection::InitProtoReflectionServerBuilderPlugin();
+    initGrpc();
 }
 
-/// @brief Run the simulation server
+/// @brief Set the address and the options of the server without starting
+/// it, so the servers of every drone can be started together later
 /// @param address adress to run the server
-void SimulationServer::Run(std::string address)
+/// @param options Limits, keepalive and compression of the server
+void SimulationServer::Configure(
+    std::string address, const ServerOptions& options)
+{
+    m_address = std::move(address);
+    m_options = options;
+
+    m_history_metric.Configure(
+        m_options.history_segment_size, m_options.history_segments);
+    m_history_distance.Configure(
+        m_options.history_segment_size, m_options.history_segments);
+    m_history_log.Configure(
+        m_options.history_segment_size, m_options.history_segments);
+}
+
+/// @brief Start the server on the configured address, does nothing if it is
+/// already running
+/// @return True if the server is listening, False if it could not start
+bool SimulationServer::Start()
 {
+    if (m_server)
+    {
+        return true;
+    }
+
     ServerBuilder builder;
+    m_options.Apply(builder);
 
     // Listen on the given address without any authentication mechanism.
-    builder.AddListeningPort(address, grpc::InsecureServerCredentials());
+    builder.AddListeningPort(m_address, grpc::InsecureServerCredentials());
 
     // Register "service" as the instance through which we'll communicate with
     // clients. In this case it corresponds to an *synchronous* service.
@@ -26,63 +65,149 @@ void SimulationServer::Run(std::string address)
     // Assemble the server.
     m_server = std::unique_ptr<Server>(builder.BuildAndStart());
 
-    std::cout << "Server listening on " << address << std::endl;
+    if (!m_server)
+    {
+        std::cerr << "Server could not listen on " << m_address << std::endl;
+        return false;
+    }
+
+    return true;
 }
 
+/// @brief Check if the server was started
+/// @return True if the server is listening
+bool SimulationServer::IsRunning() const { return m_server != nullptr; }
+
 /// @brief Get the next command in the commands queue
 /// @param command Command that is next in queue
 /// @return True if could find next command, False if no command next
 bool SimulationServer::GetNextCommand(Command* command)
 {
-    if (m_queue_command.empty())
+    return m_commands.Pop(command);
+}
+
+/// @brief Check if a command is waiting, without taking the queue lock
+/// @return True if GetNextCommand has a command to give
+bool SimulationServer::HasCommand() const { return m_commands.HasCommand(); }
+
+/// @brief Add a command to the commands queue
+/// @param command Command to execute
+/// @return Ticket to wait for the drone with, for a return command
+uint64_t SimulationServer::PushCommand(Command command)
+{
+    return m_commands.Push(std::move(command));
+}
+
+/// @brief Request an emergency stop, it bypasses the commands queue
+void SimulationServer::RequestEmergencyStop() { m_emergency_stop = true; }
+
+/// @brief Consume the emergency stop request and drop the queued commands.
+/// The requests waiting for a return are told the drone will not arrive.
+/// @return True if an emergency stop was requested, False if not
+bool SimulationServer::TakeEmergencyStop()
+{
+    if (!m_emergency_stop.exchange(false))
     {
         return false;
     }
 
-    m_queue_mutex.lock();
-    *command = m_queue_command.front();
-    m_queue_command.pop();
-    m_queue_mutex.unlock();
+    // Commands sent before the stop must not resume the mission
+    m_commands.Clear();
 
+    DroneRegistry::GetInstance().NotifyDone();
     return true;
 }
 
-/// @brief Mark that a given uri is done with its command execution
-/// @param uri Uri that is done
+/// @brief Mark that the drone is back to base, every request waiting for
+/// its return gets a done notification
 void SimulationServer::SendDone()
 {
-    m_queue_mutex.lock();
-    m_queue_done.push(true);
-    m_queue_mutex.unlock();
+    m_commands.Done();
+    DroneRegistry::GetInstance().NotifyDone();
 }
 
-/// @brief Update the telemetrics in the ServiceImplementation
-/// @param metric metric to add to the position queue
-void SimulationServer::UpdateTelemetrics(Metric metric)
+/// @brief Consume the done notification of a return if there is one
+/// @param ticket Ticket given by PushCommand
+/// @param arrived Set to True if the drone arrived, False if its return was
+/// cancelled by an emergency stop
+/// @return True if the drone was done, False if not
+bool SimulationServer::TakeDone(uint64_t ticket, bool* arrived)
 {
-    m_queue_mutex.lock();
-    m_queue_metric.push(metric);
-    m_queue_mutex.unlock();
+    return m_commands.TakeDone(ticket, arrived);
 }
 
-/// @brief Update the distances in the ServiceImplementation
-/// @param distance Distance to add to the queue
-void SimulationServer::UpdateDistances(DistanceReadings distance)
+/// @brief Forget a return whose request was cancelled, so its done is never
+/// given to another request
+/// @param ticket Ticket given by PushCommand
+void SimulationServer::CancelReturn(uint64_t ticket)
 {
-    m_queue_mutex.lock();
-    m_queue_distance.push(distance);
-    m_queue_mutex.unlock();
+    m_commands.CancelReturn(ticket);
 }
 
-/// @brief Update the status in the ServiceImplementation
-/// @param message Log message
-/// @param level Log level
-void SimulationServer::AddLog(std::string message, std::string level)
+/// @brief Add the state of the drone at the end of a tick to the history and
+/// to the subscriptions. Called once per tick by the loop functions, the
+/// controller never pushes to the server itself. Only the frame is read
+/// without locks: the history of the drone still takes its own lock for
+/// each append, shared with the history reads of this drone only.
+/// @param frame Frame of the whole swarm
+/// @param index Index of this drone in the frame
+void SimulationServer::PublishFrame(
+    const std::shared_ptr<const TickFrame>& frame, size_t index)
 {
-    m_queue_mutex.lock();
-    m_queue_log.push(LogData(message, level));
-    m_queue_mutex.unlock();
+    const DroneFrame& drone = frame->drones[index];
+
+    m_history_metric.Append(drone.metric);
+    m_history_distance.Append(drone.distance);
+    for (const LogData& log : drone.logs)
+    {
+        m_history_log.Append(log);
+    }
+
+    SubscriptionHub& swarmHub = FrameBoard::GetInstance().GetHub();
+    bool droneSubscribers = m_hub.HasSubscribers();
+    bool swarmSubscribers = swarmHub.HasSubscribers();
+    if (!droneSubscribers && !swarmSubscribers)
+    {
+        return;
+    }
+
+    // The events point inside the frame, which they keep alive, so the
+    // samples are shared with every subscriber without being copied
+    std::shared_ptr<const Metric> metric(frame, &drone.metric);
+    std::shared_ptr<const std::string> uri(frame, &drone.uri);
+    auto publish = [&](const SubscriptionEvent& event)
+    {
+        if (droneSubscribers)
+        {
+            m_hub.Publish(event);
+        }
+        if (swarmSubscribers)
+        {
+            swarmHub.Publish(event);
+        }
+    };
+
+    publish({Channel::Telemetrics, metric, nullptr, nullptr, uri});
+    publish({Channel::Status, metric, nullptr, nullptr, uri});
+    publish(
+        {Channel::Distances, nullptr,
+         std::shared_ptr<const DistanceReadings>(frame, &drone.distance),
+         nullptr, uri});
+    for (const LogData& log : drone.logs)
+    {
+        publish(
+            {Channel::Logs, nullptr, nullptr,
+             std::shared_ptr<const LogData>(frame, &log), uri});
+    }
 }
 
 /// @brief Shut down the simulation server
-void SimulationServer::Stop() { m_server->Shutdown(); }
+void SimulationServer::Stop()
+{
+    if (m_server)
+    {
+        // Waiting group commands are cancelled after the deadline
+        m_server->Shutdown(
+            std::chrono::system_clock::now() + std::chrono::seconds(1));
+    }
+}
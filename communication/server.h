@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include <iostream>
 #include <memory>
 #include <mutex>
@@ -17,8 +18,15 @@
 #include <struct/log.h>
 #include <struct/metric.h>
 #include <struct/position.h>
+#include <struct/tick_frame.h>
 
+#include "command_queue.h"
+#include "drone_registry.h"
+#include "frame_board.h"
+#include "segmented_log.h"
+#include "server_options.h"
 #include "service_implementation.h"
+#include "subscription_hub.h"
 
 using grpc::Server;
 using grpc::ServerBuilder;
@@ -30,21 +38,30 @@ class SimulationServer final
 public:
     SimulationServer();
     virtual ~SimulationServer() {}
-    void Run(std::string address);
+    void Configure(std::string address, const ServerOptions& options);
+    bool Start();
+    bool IsRunning() const;
     void Stop();
     bool GetNextCommand(Command* command);
+    bool HasCommand() const;
+    uint64_t PushCommand(Command command);
+    void RequestEmergencyStop();
+    bool TakeEmergencyStop();
     void SendDone();
-    void UpdateTelemetrics(Metric metric);
-    void UpdateDistances(DistanceReadings distance);
-    void AddLog(std::string message, std::string level);
+    bool TakeDone(uint64_t ticket, bool* arrived);
+    void CancelReturn(uint64_t ticket);
+    void PublishFrame(
+        const std::shared_ptr<const TickFrame>& frame, size_t index);
 
 private:
-    std::mutex m_queue_mutex;
-    std::queue<Command> m_queue_command;
-    std::queue<bool> m_queue_done;
-    std::queue<Metric> m_queue_metric;
-    std::queue<DistanceReadings> m_queue_distance;
-    std::queue<LogData> m_queue_log;
+    CommandQueue m_commands;
+    SegmentedLog<Metric> m_history_metric;
+    SegmentedLog<DistanceReadings> m_history_distance;
+    SegmentedLog<LogData> m_history_log;
+    std::atomic<bool> m_emergency_stop;
+    std::string m_address;
+    ServerOptions m_options;
+    SubscriptionHub m_hub;
     std::unique_ptr<Server> m_server;
     ServiceImplementation m_service;
 };
@@ -0,0 +1,82 @@
+#include "server_options.h"
+
+/// @brief Apply the options to a server before it is built
+/// @param builder Builder of the server
+void ServerOptions::Apply(grpc::ServerBuilder& builder) const
+{
+    builder.SetMaxReceiveMessageSize(max_message_size);
+    builder.SetMaxSendMessageSize(max_message_size);
+
+    builder.AddChannelArgument(GRPC_ARG_KEEPALIVE_TIME_MS, keepalive_time_ms);
+    builder.AddChannelArgument(
+        GRPC_ARG_KEEPALIVE_TIMEOUT_MS, keepalive_timeout_ms);
+    builder.AddChannelArgument(GRPC_ARG_KEEPALIVE_PERMIT_WITHOUT_CALLS, 1);
+    builder.AddChannelArgument(GRPC_ARG_HTTP2_MAX_PINGS_WITHOUT_DATA, 0);
+    if (max_connection_idle_ms > 0)
+    {
+        builder.AddChannelArgument(
+            GRPC_ARG_MAX_CONNECTION_IDLE_MS, max_connection_idle_ms);
+    }
+
+    if (min_pollers > 0)
+    {
+        builder.SetSyncServerOption(
+            grpc::ServerBuilder::SyncServerOption::MIN_POLLERS, min_pollers);
+    }
+    if (max_pollers > 0)
+    {
+        builder.SetSyncServerOption(
+            grpc::ServerBuilder::SyncServerOption::MAX_POLLERS, max_pollers);
+    }
+
+    if (max_threads > 0 || resource_quota_bytes > 0)
+    {
+        grpc::ResourceQuota quota("simulation_server");
+        if (max_threads > 0)
+        {
+            quota.SetMaxThreads(max_threads);
+        }
+        if (resource_quota_bytes > 0)
+        {
+            quota.Resize(resource_quota_bytes);
+        }
+        builder.SetResourceQuota(quota);
+    }
+}
+
+/// @brief Compress the reply of a bulk call
+/// @param context Context of the call
+void ServerOptions::Compress(grpc::ServerContext* context) const
+{
+    if (bulk_compression != GRPC_COMPRESS_NONE)
+    {
+        context->set_compression_algorithm(bulk_compression);
+    }
+}
+
+/// @brief Get a compression algorithm from its name
+/// @param name "none", "gzip" or "deflate"
+/// @param algorithm Set to the algorithm if the name is known
+/// @return True if the name is known, False if not
+bool ParseCompression(
+    const std::string& name, grpc_compression_algorithm* algorithm)
+{
+    if (name == "none")
+    {
+        *algorithm = GRPC_COMPRESS_NONE;
+    }
+    else if (name == "gzip")
+    {
+        *algorithm = GRPC_COMPRESS_GZIP;
+    }
+    else if (name == "deflate")
+    {
+        *algorithm = GRPC_COMPRESS_DEFLATE;
+    }
+    else
+    {
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <string>
+
+#include <grpc/compression.h>
+#include <grpcpp/grpcpp.h>
+
+/// Tuning of a SimulationServer, read from the experiment configuration
+struct ServerOptions
+{
+    // Largest message sent or received, backlogs of distances can be large
+    int max_message_size = 64 * 1024 * 1024;
+
+    // Pings sent on idle connections, so dead clients are detected
+    int keepalive_time_ms = 30000;
+    int keepalive_timeout_ms = 10000;
+
+    // Connections without any call for this long are closed (0: never)
+    int max_connection_idle_ms = 300000;
+
+    // Threads polling for calls (0: gRPC default)
+    int min_pollers = 0;
+    int max_pollers = 0;
+
+    // Limits of the resource quota (0: unlimited)
+    int max_threads = 0;
+    size_t resource_quota_bytes = 0;
+
+    // Samples kept for the history requests, per segment and in segments
+    size_t history_segment_size = 128;
+    size_t history_segments = 64;
+
+    // Compression of the bulk replies (telemetrics, distances, logs, streams)
+    grpc_compression_algorithm bulk_compression = GRPC_COMPRESS_NONE;
+
+    void Apply(grpc::ServerBuilder& builder) const;
+    void Compress(grpc::ServerContext* context) const;
+};
+
+bool ParseCompression(
+    const std::string& name, grpc_compression_algorithm* algorithm);
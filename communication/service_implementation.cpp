@@ -1,19 +1,95 @@
 #include "service_implementation.h"
 
+#include "server.h"
+
+/// @brief Fill a rpc position
+/// @param position Position to convert
+/// @param rpc_position Position of the reply
+static void toRpc(const Position& position, simulation::Position* rpc_position)
+{
+    rpc_position->set_x(position.posX);
+    rpc_position->set_y(position.posY);
+    rpc_position->set_z(position.posZ);
+}
+
+/// @brief Fill a rpc telemetric
+/// @param metric Metric to convert
+/// @param telemetric Telemetric of the reply
+static void toRpc(const Metric& metric, Telemetric* telemetric)
+{
+    telemetric->set_status(metric.status);
+    toRpc(metric.position, telemetric->mutable_position());
+    telemetric->set_battery_level(metric.battery_level);
+}
+
+/// @brief Fill a rpc distance
+/// @param distance Distances to convert
+/// @param obstacle Distance of the reply
+static void toRpc(const DistanceReadings& distance, DistanceObstacle* obstacle)
+{
+    obstacle->set_front(distance.front);
+    obstacle->set_back(distance.back);
+    obstacle->set_left(distance.left);
+    obstacle->set_right(distance.right);
+    toRpc(distance.position, obstacle->mutable_position());
+}
+
+/// @brief Fill a rpc log
+/// @param log Log to convert
+/// @param logData Log of the reply
+static void toRpc(const LogData& log, simulation::LogData* logData)
+{
+    logData->set_level(log.level());
+    logData->set_message(log.message());
+}
+
+/// @brief Read the history of a drone from the cursor of the request, the
+/// shared cursor is used and moved forward when the request has none
+/// @param history History to read
+/// @param request Request from the server
+/// @param sharedCursor Cursor of the requests without a cursor
+/// @param mutex Mutex of the shared cursor
+/// @param reply Reply to the server
+/// @param add Adds a sample to the reply
+template <typename T, typename Reply, typename Add>
+static void readHistory(
+    const SegmentedLog<T>& history, const HistoryRequest& request,
+    uint64_t& sharedCursor, std::mutex& mutex, Reply* reply, Add add)
+{
+    auto visit = [reply, &add](uint64_t, const T& value)
+    { toRpc(value, add(reply)); };
+
+    reply->set_first_cursor(history.FirstSequence());
+
+    if (request.has_cursor())
+    {
+        reply->set_next_cursor(
+            history.Read(request.cursor(), request.limit(), visit));
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    sharedCursor = history.Read(sharedCursor, request.limit(), visit);
+    reply->set_next_cursor(sharedCursor);
+}
+
 /// @brief Constructor of the ServiceImplementation class
-/// @param mutex mutex
-/// @param command_queue Commands queue
-/// @param queue_metric Metric queue
-/// @param distance_queue Distances queue
-/// @param queue_log Logs queue
+/// @param commands Commands queue and returns waiting for the drone
+/// @param history_metric Metric history
+/// @param history_distance Distances history
+/// @param history_log Logs history
+/// @param emergency_stop Emergency stop flag, read by the drone every step
+/// @param options Options of the server, used for the compression of replies
+/// @param hub Subscriptions to the drone's samples
 ServiceImplementation::ServiceImplementation(
-    std::mutex& mutex, std::queue<Command>& command_queue,
-    std::queue<bool>& done_queue, std::queue<Metric>& queue_metric,
-    std::queue<DistanceReadings>& queue_distance,
-    std::queue<LogData>& queue_log)
-    : m_queue_mutex(mutex), m_queue_command(command_queue),
-      m_queue_done(done_queue), m_queue_metric(queue_metric),
-      m_queue_distance(queue_distance), m_queue_log(queue_log)
+    CommandQueue& commands, SegmentedLog<Metric>& history_metric,
+    SegmentedLog<DistanceReadings>& history_distance,
+    SegmentedLog<LogData>& history_log, std::atomic<bool>& emergency_stop,
+    const ServerOptions& options, SubscriptionHub& hub)
+    : m_commands(commands), m_history_metric(history_metric),
+      m_history_distance(history_distance), m_history_log(history_log),
+      m_emergency_stop(emergency_stop), m_options(options), m_hub(hub),
+      m_cursor_metric(0), m_cursor_distance(0), m_cursor_log(0)
 {
 }
 
@@ -25,11 +101,7 @@ ServiceImplementation::ServiceImplementation(
 Status ServiceImplementation::StartMission(
     ServerContext* context, const MissionRequest* request, MissionReply* reply)
 {
-    Command command = {request->uri(), Action::Start};
-
-    m_queue_mutex.lock();
-    m_queue_command.push(command);
-    m_queue_mutex.unlock();
+    m_commands.Push({request->uri(), Action::Start});
 
     reply->set_message("Success");
     return Status::OK;
@@ -43,17 +115,15 @@ Status ServiceImplementation::StartMission(
 Status ServiceImplementation::EndMission(
     ServerContext* context, const MissionRequest* request, MissionReply* reply)
 {
-    Command command = {request->uri(), Action::Stop};
-
-    m_queue_mutex.lock();
-    m_queue_command.push(command);
-    m_queue_mutex.unlock();
+    m_commands.Push({request->uri(), Action::Stop});
 
     reply->set_message("Success");
     return Status::OK;
 }
 
-/// @brief Put the return command in the command queue
+/// @brief Put the return command in the command queue and wait until the
+/// drone is back to base, its return is cancelled by an emergency stop or
+/// the client cancels
 /// @param context Server context
 /// @param request Request from the server
 /// @param reply Reply to the server
@@ -61,145 +131,433 @@ Status ServiceImplementation::EndMission(
 Status ServiceImplementation::ReturnToBase(
     ServerContext* context, const MissionRequest* request, MissionReply* reply)
 {
-    std::cout << "starting" << std::endl;
-    Command command = {request->uri(), Action::Return};
+    uint64_t ticket = m_commands.Push({request->uri(), Action::Return});
 
-    m_queue_mutex.lock();
-    m_queue_command.push(command);
-    m_queue_mutex.unlock();
-
-    bool inProgress = true;
-    const int WAIT_INTERVAL = 1000;
-    while (inProgress)
+    DroneRegistry& registry = DroneRegistry::GetInstance();
+    const std::chrono::milliseconds WAIT_INTERVAL(1000);
+    bool arrived = false;
+    while (!context->IsCancelled())
     {
-        std::this_thread::sleep_for(std::chrono::milliseconds(WAIT_INTERVAL));
-        m_queue_mutex.lock();
-
-        if (!m_queue_done.empty())
+        unsigned long generation = registry.GetDoneGeneration();
+        if (m_commands.TakeDone(ticket, &arrived))
         {
-            m_queue_done.pop();
-            inProgress = false;
+            if (!arrived)
+            {
+                return Status(grpc::StatusCode::ABORTED, "Emergency stop");
+            }
+
+            reply->set_message("Success");
+            return Status::OK;
         }
 
-        m_queue_mutex.unlock();
+        registry.WaitForDone(generation, WAIT_INTERVAL);
     }
 
+    // The done of this return must not be taken by a later request
+    m_commands.CancelReturn(ticket);
+    return Status::CANCELLED;
+}
+
+/// @brief Request an emergency stop. The flag is read at the start of the
+/// next step, without going through the commands queue or the action timer
+/// @param context Server context
+/// @param request Request from the server
+/// @param reply Reply to the server
+/// @return Status of the request
+Status ServiceImplementation::EmergencyStop(
+    ServerContext* context, const MissionRequest* request, MissionReply* reply)
+{
+    m_emergency_stop = true;
+
     reply->set_message("Success");
     return Status::OK;
 }
 
-/// @brief Set the reply to send telemetrics to server
+/// @brief Set the reply to send the telemetrics since the request cursor
 /// @param context Server context
 /// @param request Request from the server
 /// @param reply Reply to the server
 /// @return Status of the request
 Status ServiceImplementation::GetTelemetrics(
-    ServerContext* context, const MissionRequest* request,
+    ServerContext* context, const HistoryRequest* request,
     TelemetricsReply* reply)
 {
-    if (m_queue_metric.empty())
-    {
-        return Status::OK;
-    }
+    m_options.Compress(context);
 
-    m_queue_mutex.lock();
+    readHistory(
+        m_history_metric, *request, m_cursor_metric, m_cursor_mutex, reply,
+        [](TelemetricsReply* reply) { return reply->add_telemetric(); });
 
-    while (!m_queue_metric.empty())
-    {
-        Metric metric = m_queue_metric.front();
-        Position position = metric.position;
-        int status = metric.status;
+    return Status::OK;
+}
 
-        Telemetric* telemetric = reply->add_telemetric();
-        simulation::Position* rpc_position = new simulation::Position();
+/// @brief Set the reply to send the distances since the request cursor
+/// @param context Server context
+/// @param request Request from the server
+/// @param reply Reply to the server
+/// @return Status of the request
+Status ServiceImplementation::GetDistances(
+    ServerContext* context, const HistoryRequest* request,
+    DistancesReply* reply)
+{
+    m_options.Compress(context);
 
-        rpc_position->set_x(position.posX);
-        rpc_position->set_y(position.posY);
-        rpc_position->set_z(position.posZ);
+    readHistory(
+        m_history_distance, *request, m_cursor_distance, m_cursor_mutex, reply,
+        [](DistancesReply* reply) { return reply->add_distanceobstacle(); });
 
-        telemetric->set_status(status);
-        telemetric->set_allocated_position(rpc_position);
-        telemetric->set_battery_level(metric.battery_level);
+    return Status::OK;
+}
 
-        m_queue_metric.pop();
-    }
+/// @brief Set the reply to send the logs since the request cursor
+/// @param context Server context
+/// @param request Request from the server
+/// @param reply Reply to the server
+/// @return Status of the request
+Status ServiceImplementation::GetLogs(
+    ServerContext* context, const HistoryRequest* request, LogReply* reply)
+{
+    m_options.Compress(context);
 
-    m_queue_mutex.unlock();
+    readHistory(
+        m_history_log, *request, m_cursor_log, m_cursor_mutex, reply,
+        [](LogReply* reply) { return reply->add_logs(); });
 
     return Status::OK;
 }
 
-/// @brief Set the reply to send distances to server
+/// @brief Set the reply to list every drone of the simulation and its port
 /// @param context Server context
 /// @param request Request from the server
 /// @param reply Reply to the server
 /// @return Status of the request
-Status ServiceImplementation::GetDistances(
-    ServerContext* context, const MissionRequest* request,
-    DistancesReply* reply)
+Status ServiceImplementation::ListDrones(
+    ServerContext* context, const DronesRequest* request, DronesReply* reply)
+{
+    for (const DroneEndpoint& endpoint :
+         DroneRegistry::GetInstance().GetDrones())
+    {
+        simulation::Drone* drone = reply->add_drones();
+
+        drone->set_uri(endpoint.uri);
+        drone->set_slot(endpoint.slot);
+        drone->set_port(endpoint.port);
+    }
+
+    return Status::OK;
+}
+
+/// @brief Send a command to several drones at once. A reply is streamed when
+/// the command is queued for each drone and, for the return command, when
+/// each drone is back to base.
+/// @param context Server context
+/// @param request Request from the server
+/// @param writer Stream of replies to the server
+/// @return Status of the request
+Status ServiceImplementation::GroupCommand(
+    ServerContext* context, const GroupRequest* request,
+    ServerWriter<GroupReply>* writer)
 {
-    if (m_queue_distance.empty())
+    if (!simulation::Action_IsValid(request->action()))
+    {
+        return Status(grpc::StatusCode::INVALID_ARGUMENT, "Unknown action");
+    }
+    Action action = static_cast<Action>(request->action());
+
+    DroneRegistry& registry = DroneRegistry::GetInstance();
+
+    std::vector<std::string> uris;
+    for (const std::string& uri : request->uris())
+    {
+        if (uri == "all")
+        {
+            uris = registry.GetUris();
+            break;
+        }
+        uris.push_back(uri);
+    }
+
+    // Every command is queued before any reply is written, so all drones
+    // pick up their command within the same tick. A return is waited for
+    // with the ticket of its drone.
+    std::vector<std::pair<std::string, uint64_t>> queued;
+    std::vector<GroupReply> replies(uris.size());
+    for (size_t i = 0; i < uris.size(); ++i)
+    {
+        uint64_t ticket = 0;
+        bool found = registry.WithServer(
+            uris[i],
+            [&](SimulationServer& server)
+            {
+                if (action == Action::EmergencyStop)
+                {
+                    server.RequestEmergencyStop();
+                }
+                else
+                {
+                    ticket = server.PushCommand({uris[i], action});
+                }
+            });
+
+        replies[i].set_uri(uris[i]);
+        replies[i].set_message(found ? "Queued" : "Unknown drone");
+        if (found)
+        {
+            queued.emplace_back(uris[i], ticket);
+        }
+    }
+
+    for (const GroupReply& reply : replies)
+    {
+        writer->Write(reply);
+    }
+
+    if (action != Action::Return)
     {
         return Status::OK;
     }
 
-    m_queue_mutex.lock();
+    const std::chrono::milliseconds WAIT_INTERVAL(1000);
+    while (!queued.empty() && !context->IsCancelled())
+    {
+        unsigned long generation = registry.GetDoneGeneration();
+
+        for (auto drone = queued.begin(); drone != queued.end();)
+        {
+            bool done = false;
+            bool arrived = false;
+            bool found = registry.WithServer(
+                drone->first, [&](SimulationServer& server)
+                { done = server.TakeDone(drone->second, &arrived); });
+
+            if (!found || done)
+            {
+                GroupReply reply;
+                reply.set_uri(drone->first);
+                reply.set_message(
+                    !found ? "Unknown drone"
+                           : (arrived ? "Done" : "Emergency stop"));
+                writer->Write(reply);
+
+                drone = queued.erase(drone);
+            }
+            else
+            {
+                ++drone;
+            }
+        }
 
-    while (!m_queue_distance.empty())
+        if (!queued.empty())
+        {
+            registry.WaitForDone(generation, WAIT_INTERVAL);
+        }
+    }
+
+    if (queued.empty())
     {
-        DistanceReadings distance = m_queue_distance.front();
-        Position position = distance.position;
+        return Status::OK;
+    }
 
-        DistanceObstacle* newDistance = reply->add_distanceobstacle();
-        simulation::Position* rpc_position = new simulation::Position();
+    // The dones of the drones still returning must not be taken by a later
+    // request
+    for (const auto& drone : queued)
+    {
+        registry.WithServer(
+            drone.first, [&](SimulationServer& server)
+            { server.CancelReturn(drone.second); });
+    }
+    return Status::CANCELLED;
+}
 
-        rpc_position->set_x(position.posX);
-        rpc_position->set_y(position.posY);
-        rpc_position->set_z(position.posZ);
+/// @brief Stream the samples of the drone that pass the filter of the client
+/// until the client cancels. With the uri "all", the samples of every drone
+/// of the simulation are streamed, each update holding the uri of its drone.
+/// @param context Server context
+/// @param request Channels and decimation wanted by the client
+/// @param writer Stream of updates to the client
+/// @return Status of the request
+Status ServiceImplementation::Subscribe(
+    ServerContext* context, const SubscriptionRequest* request,
+    ServerWriter<SubscriptionUpdate>* writer)
+{
+    m_options.Compress(context);
 
-        newDistance->set_front(distance.front);
-        newDistance->set_back(distance.back);
-        newDistance->set_left(distance.left);
-        newDistance->set_right(distance.right);
+    SubscriptionFilter filter;
+    filter.decimation = request->decimation();
+    for (int channel : request->channels())
+    {
+        switch (channel)
+        {
+        case simulation::TELEMETRICS:
+            filter.telemetrics = true;
+            break;
+        case simulation::DISTANCES:
+            filter.distances = true;
+            break;
+        case simulation::LOGS:
+            filter.logs = true;
+            break;
+        case simulation::STATUS:
+            filter.status = true;
+            break;
+        default:
+            return Status(
+                grpc::StatusCode::INVALID_ARGUMENT, "Unknown channel");
+        }
+    }
+
+    SubscriptionHub& hub = request->uri() == "all"
+                               ? FrameBoard::GetInstance().GetHub()
+                               : m_hub;
+    std::shared_ptr<Subscriber> subscriber = hub.Subscribe(filter);
 
-        newDistance->set_allocated_position(rpc_position);
+    const std::chrono::milliseconds WAIT_INTERVAL(1000);
+    std::vector<SubscriptionEvent> events;
+    bool connected = true;
+    while (connected && !context->IsCancelled())
+    {
+        if (!subscriber->Wait(&events, WAIT_INTERVAL))
+        {
+            continue;
+        }
 
-        m_queue_distance.pop();
+        for (const SubscriptionEvent& event : events)
+        {
+            SubscriptionUpdate update;
+            switch (event.channel)
+            {
+            case Channel::Telemetrics:
+                toRpc(*event.metric, update.mutable_telemetric());
+                break;
+            case Channel::Distances:
+                toRpc(*event.distance, update.mutable_distanceobstacle());
+                break;
+            case Channel::Logs:
+                toRpc(*event.log, update.mutable_log());
+                break;
+            case Channel::Status:
+                update.set_status(event.metric->status);
+                break;
+            }
+            if (event.uri)
+            {
+                update.set_uri(*event.uri);
+            }
+
+            if (!writer->Write(update))
+            {
+                connected = false;
+                break;
+            }
+        }
     }
 
-    m_queue_mutex.unlock();
+    hub.Unsubscribe(subscriber);
 
     return Status::OK;
 }
 
-/// @brief Set the reply to send log to server
+/// @brief Set the reply to send the exploration metrics of the swarm
 /// @param context Server context
 /// @param request Request from the server
 /// @param reply Reply to the server
 /// @return Status of the request
-Status ServiceImplementation::GetLogs(
-    ServerContext* context, const MissionRequest* request, LogReply* reply)
+Status ServiceImplementation::GetCoverage(
+    ServerContext* context, const CoverageRequest* request,
+    CoverageReply* reply)
 {
-    if (m_queue_log.empty())
+    std::shared_ptr<const CoverageReport> report =
+        CoverageBoard::GetInstance().Get();
+    if (!report)
     {
-        return Status::OK;
+        return Status(
+            grpc::StatusCode::UNAVAILABLE, "Coverage is not computed");
     }
 
-    m_queue_mutex.lock();
+    reply->set_tick(report->tick);
+    reply->set_covered_area(report->covered_area);
+    reply->set_coverage_ratio(report->coverage_ratio);
+    reply->set_overlap_ratio(report->overlap_ratio);
 
-    while (!m_queue_log.empty())
+    for (const DroneCoverage& drone : report->drones)
     {
-        LogData log = m_queue_log.front();
+        simulation::DroneCoverage* rpc_drone = reply->add_drones();
+        rpc_drone->set_uri(drone.uri);
+        rpc_drone->set_distance(drone.distance);
+        rpc_drone->set_discovered_cells(drone.discovered_cells);
+    }
 
-        simulation::LogData* logData = reply->add_logs();
+    if (request->history())
+    {
+        const SegmentedLog<CoveragePoint>& history =
+            CoverageBoard::GetInstance().GetHistory();
+
+        reply->set_first_cursor(history.FirstSequence());
+        reply->set_next_cursor(history.Read(
+            request->cursor(), request->limit(),
+            [reply](uint64_t, const CoveragePoint& point)
+            {
+                simulation::CoveragePoint* rpc_point = reply->add_history();
+                rpc_point->set_tick(point.tick);
+                rpc_point->set_covered_area(point.covered_area);
+            }));
+    }
 
-        logData->set_level(log.level);
-        logData->set_message(log.message);
+    return Status::OK;
+}
 
-        m_queue_log.pop();
+/// @brief Set the reply to send the state of every drone at the last tick
+/// @param context Server context
+/// @param request Request from the server
+/// @param reply Reply to the server
+/// @return Status of the request
+Status ServiceImplementation::GetSwarmFrame(
+    ServerContext* context, const FrameRequest* request, FrameReply* reply)
+{
+    m_options.Compress(context);
+
+    std::shared_ptr<const TickFrame> frame = FrameBoard::GetInstance().Get();
+    if (!frame)
+    {
+        return Status(grpc::StatusCode::UNAVAILABLE, "No tick yet");
+    }
+
+    reply->set_tick(frame->tick);
+    for (const DroneFrame& drone : frame->drones)
+    {
+        simulation::DroneState* state = reply->add_drones();
+        state->set_uri(drone.uri);
+        toRpc(drone.metric, state->mutable_telemetric());
+        toRpc(drone.distance, state->mutable_distanceobstacle());
+    }
+
+    return Status::OK;
+}
+
+/// @brief Set the reply to send the timings of the ticks
+/// @param context Server context
+/// @param request Request from the server
+/// @param reply Reply to the server
+/// @return Status of the request
+Status ServiceImplementation::GetPacing(
+    ServerContext* context, const PacingRequest* request, PacingReply* reply)
+{
+    PacingReport report;
+    if (!PacingBoard::GetInstance().Get(&report))
+    {
+        return Status(
+            grpc::StatusCode::UNAVAILABLE, "No tick has been timed");
     }
 
-    m_queue_mutex.unlock();
+    reply->set_tick(report.tick);
+    reply->set_ticks(report.ticks);
+    reply->set_overruns(report.overruns);
+    reply->set_real_time_factor(report.real_time_factor);
+    reply->set_achieved_factor(report.achieved_factor);
+    reply->set_budget_us(report.budget_us);
+    reply->set_last_tick_us(report.last_tick_us);
+    reply->set_mean_tick_us(report.mean_tick_us);
+    reply->set_max_tick_us(report.max_tick_us);
 
     return Status::OK;
 }
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include <chrono>
 #include <iostream>
 #include <memory>
@@ -12,35 +13,57 @@
 #include <grpcpp/grpcpp.h>
 #include <grpcpp/health_check_service_interface.h>
 
+#include "command_queue.h"
+#include "coverage_board.h"
+#include "drone_registry.h"
+#include "frame_board.h"
+#include "pacing_board.h"
+#include "segmented_log.h"
+#include "server_options.h"
 #include "simulation.grpc.pb.h"
+#include "subscription_hub.h"
 #include <struct/command.h>
 #include <struct/distance_reading.h>
 #include <struct/log.h>
 #include <struct/metric.h>
 #include <struct/position.h>
 
+using simulation::CoverageReply;
+using simulation::CoverageRequest;
 using simulation::DistanceObstacle;
 using simulation::DistancesReply;
+using simulation::DronesReply;
+using simulation::DronesRequest;
+using simulation::FrameReply;
+using simulation::FrameRequest;
+using simulation::GroupReply;
+using simulation::GroupRequest;
+using simulation::HistoryRequest;
 using simulation::LogReply;
 using simulation::MissionReply;
 using simulation::MissionRequest;
+using simulation::PacingReply;
+using simulation::PacingRequest;
 using simulation::Simulation;
+using simulation::SubscriptionRequest;
+using simulation::SubscriptionUpdate;
 using simulation::Telemetric;
 using simulation::TelemetricsReply;
 
 using grpc::Server;
 using grpc::ServerBuilder;
 using grpc::ServerContext;
+using grpc::ServerWriter;
 using grpc::Status;
 
 class ServiceImplementation final : public Simulation::Service
 {
 public:
     ServiceImplementation(
-        std::mutex& mutex, std::queue<Command>& command_queue,
-        std::queue<bool>& done_queue, std::queue<Metric>& queue_metric,
-        std::queue<DistanceReadings>& queue_distance,
-        std::queue<LogData>& queue_log);
+        CommandQueue& commands, SegmentedLog<Metric>& history_metric,
+        SegmentedLog<DistanceReadings>& history_distance,
+        SegmentedLog<LogData>& history_log, std::atomic<bool>& emergency_stop,
+        const ServerOptions& options, SubscriptionHub& hub);
     Status StartMission(
         ServerContext* context, const MissionRequest* request,
         MissionReply* reply) override;
@@ -50,20 +73,48 @@ public:
     Status ReturnToBase(
         ServerContext* context, const MissionRequest* request,
         MissionReply* reply) override;
-    Status GetTelemetrics(
+    Status EmergencyStop(
         ServerContext* context, const MissionRequest* request,
+        MissionReply* reply) override;
+    Status GetTelemetrics(
+        ServerContext* context, const HistoryRequest* request,
         TelemetricsReply* reply);
     Status GetDistances(
-        ServerContext* context, const MissionRequest* request,
+        ServerContext* context, const HistoryRequest* request,
         DistancesReply* reply);
     Status GetLogs(
-        ServerContext* context, const MissionRequest* request, LogReply* reply);
+        ServerContext* context, const HistoryRequest* request, LogReply* reply);
+    Status ListDrones(
+        ServerContext* context, const DronesRequest* request,
+        DronesReply* reply) override;
+    Status GroupCommand(
+        ServerContext* context, const GroupRequest* request,
+        ServerWriter<GroupReply>* writer) override;
+    Status Subscribe(
+        ServerContext* context, const SubscriptionRequest* request,
+        ServerWriter<SubscriptionUpdate>* writer) override;
+    Status GetCoverage(
+        ServerContext* context, const CoverageRequest* request,
+        CoverageReply* reply) override;
+    Status GetSwarmFrame(
+        ServerContext* context, const FrameRequest* request,
+        FrameReply* reply) override;
+    Status GetPacing(
+        ServerContext* context, const PacingRequest* request,
+        PacingReply* reply) override;
 
 private:
-    std::mutex& m_queue_mutex;
-    std::queue<Command>& m_queue_command;
-    std::queue<bool>& m_queue_done;
-    std::queue<Metric>& m_queue_metric;
-    std::queue<DistanceReadings>& m_queue_distance;
-    std::queue<LogData>& m_queue_log;
+    CommandQueue& m_commands;
+    SegmentedLog<Metric>& m_history_metric;
+    SegmentedLog<DistanceReadings>& m_history_distance;
+    SegmentedLog<LogData>& m_history_log;
+    std::atomic<bool>& m_emergency_stop;
+    const ServerOptions& m_options;
+    SubscriptionHub& m_hub;
+
+    // Cursors of the requests made without a cursor
+    std::mutex m_cursor_mutex;
+    uint64_t m_cursor_metric;
+    uint64_t m_cursor_distance;
+    uint64_t m_cursor_log;
 };
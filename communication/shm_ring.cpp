@@ -0,0 +1,312 @@
+#include "shm_ring.h"
+
+#include <cstring>
+#include <iostream>
+#include <new>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/// @brief Get the size of a ring in shared memory
+/// @param capacity Number of slots
+/// @return Size, in bytes
+static size_t ringSize(uint32_t capacity)
+{
+    return sizeof(ShmRingHeader) + capacity * sizeof(ShmRingSlot);
+}
+
+/// @brief Constructor of the ShmRingWriter, the ring is created by Open
+ShmRingWriter::ShmRingWriter()
+    : m_memory(nullptr), m_size(0), m_header(nullptr), m_slots(nullptr),
+      m_head(0)
+{
+}
+
+/// @brief Destructor of the ShmRingWriter, removes the ring
+ShmRingWriter::~ShmRingWriter() { Close(); }
+
+/// @brief Create the ring, a ring left by a previous run is replaced
+/// @param name Name of the shared memory, starting with '/'
+/// @param capacity Number of samples kept, rounded up to a power of two
+/// @return True if the ring was created, False if not
+bool ShmRingWriter::Open(const std::string& name, uint32_t capacity)
+{
+    Close();
+
+    uint32_t rounded = 1;
+    while (rounded < capacity)
+    {
+        rounded <<= 1;
+    }
+
+    shm_unlink(name.c_str());
+    int fd = shm_open(name.c_str(), O_CREAT | O_RDWR | O_EXCL, 0644);
+    if (fd < 0)
+    {
+        std::cerr << "Could not create shared memory " << name << ": "
+                  << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    // The new memory is filled with zeros, so every slot starts empty
+    size_t size = ringSize(rounded);
+    void* memory = MAP_FAILED;
+    if (ftruncate(fd, size) == 0)
+    {
+        memory =
+            mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+
+    if (memory == MAP_FAILED)
+    {
+        std::cerr << "Could not map shared memory " << name << ": "
+                  << std::strerror(errno) << std::endl;
+        shm_unlink(name.c_str());
+        return false;
+    }
+
+    m_name = name;
+    m_memory = memory;
+    m_size = size;
+    m_head = 0;
+    m_header = new (memory) ShmRingHeader();
+    m_slots = reinterpret_cast<ShmRingSlot*>(m_header + 1);
+    for (uint32_t i = 0; i < rounded; ++i)
+    {
+        new (&m_slots[i]) ShmRingSlot();
+        m_slots[i].sequence.store(0, std::memory_order_relaxed);
+    }
+
+    m_header->version = ShmRingHeader::VERSION;
+    m_header->record_size = sizeof(WireSample);
+    m_header->capacity = rounded;
+    m_header->head.store(0, std::memory_order_relaxed);
+
+    // Readers check the magic last, once the header is complete
+    std::atomic_thread_fence(std::memory_order_release);
+    m_header->magic = ShmRingHeader::MAGIC;
+
+    return true;
+}
+
+/// @brief Unmap and remove the ring
+void ShmRingWriter::Close()
+{
+    if (m_memory == nullptr)
+    {
+        return;
+    }
+
+    munmap(m_memory, m_size);
+    shm_unlink(m_name.c_str());
+    m_memory = nullptr;
+    m_header = nullptr;
+    m_slots = nullptr;
+}
+
+/// @brief Check if the ring was created
+/// @return True if samples can be written
+bool ShmRingWriter::IsOpen() const { return m_memory != nullptr; }
+
+/// @brief Write a sample, over the oldest one once the ring is full
+/// @param sample Sample to write
+void ShmRingWriter::Write(const WireSample& sample)
+{
+    ShmRingSlot& slot = m_slots[m_head & (m_header->capacity - 1)];
+
+    // Readers seeing an odd sequence, or a sequence that changed while they
+    // copied the sample, drop their copy
+    slot.sequence.store(2 * m_head + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(&slot.sample, &sample, sizeof(WireSample));
+    slot.sequence.store(2 * m_head + 2, std::memory_order_release);
+
+    ++m_head;
+    m_header->head.store(m_head, std::memory_order_release);
+}
+
+/// @brief Constructor of the ShmRingReader, the ring is mapped by Open
+ShmRingReader::ShmRingReader()
+    : m_device(0), m_inode(0), m_memory(nullptr), m_size(0),
+      m_header(nullptr), m_slots(nullptr), m_cursor(0), m_lost(0)
+{
+}
+
+/// @brief Destructor of the ShmRingReader
+ShmRingReader::~ShmRingReader() { Close(); }
+
+/// @brief Map a ring created by the simulation
+/// @param name Name of the shared memory, starting with '/'
+/// @param fromOldest Start from the oldest sample kept instead of the next
+/// sample written
+/// @return True if the ring was mapped, False if it does not exist yet
+bool ShmRingReader::Open(const std::string& name, bool fromOldest)
+{
+    Close();
+    m_name = name;
+    m_lost = 0;
+
+    return Map(fromOldest);
+}
+
+/// @brief Map the ring that has the name of the reader
+/// @param fromOldest Start from the oldest sample kept instead of the next
+/// sample written
+/// @return True if the ring was mapped, False if it does not exist yet
+bool ShmRingReader::Map(bool fromOldest)
+{
+    int fd = shm_open(m_name.c_str(), O_RDONLY, 0);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    struct stat status;
+    if (fstat(fd, &status) != 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    // magic, version, record_size and capacity
+    uint32_t header[4];
+    if (pread(fd, header, sizeof(header), 0) != sizeof(header) ||
+        header[0] != ShmRingHeader::MAGIC ||
+        header[1] != ShmRingHeader::VERSION ||
+        header[2] != sizeof(WireSample))
+    {
+        close(fd);
+        return false;
+    }
+
+    size_t size = ringSize(header[3]);
+    void* memory = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (memory == MAP_FAILED)
+    {
+        return false;
+    }
+
+    m_device = status.st_dev;
+    m_inode = status.st_ino;
+    m_memory = memory;
+    m_size = size;
+    m_header = static_cast<const ShmRingHeader*>(memory);
+    m_slots = reinterpret_cast<const ShmRingSlot*>(m_header + 1);
+
+    uint64_t head = m_header->head.load(std::memory_order_acquire);
+    m_cursor = head;
+    if (fromOldest)
+    {
+        m_cursor = head > m_header->capacity ? head - m_header->capacity : 0;
+    }
+
+    return true;
+}
+
+/// @brief Unmap the ring and forget it
+void ShmRingReader::Close()
+{
+    Unmap();
+    m_name.clear();
+}
+
+/// @brief Unmap the ring, keeping its name to map it again
+void ShmRingReader::Unmap()
+{
+    if (m_memory == nullptr)
+    {
+        return;
+    }
+
+    munmap(m_memory, m_size);
+    m_memory = nullptr;
+    m_header = nullptr;
+    m_slots = nullptr;
+}
+
+/// @brief Check if the name of the ring now refers to a new ring, created
+/// by a new run after the mapped one was removed
+/// @return True if a new ring exists under the name
+bool ShmRingReader::WasCreatedAgain() const
+{
+    int fd = shm_open(m_name.c_str(), O_RDONLY, 0);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    struct stat status;
+    bool createdAgain = fstat(fd, &status) == 0 &&
+                        (status.st_dev != m_device || status.st_ino != m_inode);
+    close(fd);
+
+    return createdAgain;
+}
+
+/// @brief Copy the samples written since the last read, never blocks
+/// @param samples Where the samples are copied
+/// @param max Maximum number of samples copied
+/// @return Number of samples copied
+size_t ShmRingReader::Read(WireSample* samples, size_t max)
+{
+    if (m_name.empty())
+    {
+        return 0;
+    }
+
+    // The writer removes its ring and creates a new one, the mapped ring
+    // stops receiving samples, so the name is only checked once it is idle
+    if (m_memory != nullptr &&
+        m_header->head.load(std::memory_order_acquire) == m_cursor &&
+        WasCreatedAgain())
+    {
+        Unmap();
+    }
+    if (m_memory == nullptr && !Map(true))
+    {
+        return 0;
+    }
+
+    uint64_t head = m_header->head.load(std::memory_order_acquire);
+    uint64_t capacity = m_header->capacity;
+    if (head - m_cursor > capacity)
+    {
+        // The writer went around the ring, the oldest samples are gone
+        m_lost += head - capacity - m_cursor;
+        m_cursor = head - capacity;
+    }
+
+    size_t count = 0;
+    while (count < max && m_cursor < head)
+    {
+        const ShmRingSlot& slot = m_slots[m_cursor & (capacity - 1)];
+        uint64_t expected = 2 * m_cursor + 2;
+
+        uint64_t before = slot.sequence.load(std::memory_order_acquire);
+        std::memcpy(&samples[count], &slot.sample, sizeof(WireSample));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t after = slot.sequence.load(std::memory_order_relaxed);
+
+        if (before == expected && after == expected)
+        {
+            ++count;
+        }
+        else
+        {
+            // Overwritten while it was copied
+            ++m_lost;
+        }
+        ++m_cursor;
+    }
+
+    return count;
+}
+
+/// @brief Get the number of samples overwritten before they were read
+/// @return Number of samples lost
+uint64_t ShmRingReader::GetLost() const { return m_lost; }
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+#include <sys/types.h>
+
+#include <struct/wire_sample.h>
+
+// The counters of the ring are std::atomic<uint64_t>, whose lock-free macro
+// depends on the type uint64_t is on this platform
+static_assert(
+    (std::is_same<uint64_t, unsigned long>::value
+         ? ATOMIC_LONG_LOCK_FREE
+         : ATOMIC_LLONG_LOCK_FREE) == 2,
+    "The ring is shared between processes");
+
+/// Layout of the shared memory, a header followed by the slots
+struct ShmRingHeader
+{
+    static const uint32_t MAGIC = 0x53494d52;
+    static const uint32_t VERSION = 1;
+
+    uint32_t magic;
+    uint32_t version;
+    uint32_t record_size;
+    uint32_t capacity;
+
+    // Number of samples written since the ring was created
+    std::atomic<uint64_t> head;
+};
+
+struct ShmRingSlot
+{
+    // 2n + 1 while sample n is written, 2n + 2 once it is complete
+    std::atomic<uint64_t> sequence;
+    WireSample sample;
+};
+
+/// Writes the samples of the drones in a POSIX shared memory ring, for the
+/// backends running on the same host. There is a single writer, the readers
+/// never block it and are only told how many samples they missed.
+class ShmRingWriter final
+{
+public:
+    ShmRingWriter();
+    ~ShmRingWriter();
+
+    bool Open(const std::string& name, uint32_t capacity);
+    void Close();
+    bool IsOpen() const;
+
+    void Write(const WireSample& sample);
+
+private:
+    ShmRingWriter(const ShmRingWriter&) = delete;
+    ShmRingWriter& operator=(const ShmRingWriter&) = delete;
+
+    std::string m_name;
+    void* m_memory;
+    size_t m_size;
+    ShmRingHeader* m_header;
+    ShmRingSlot* m_slots;
+    uint64_t m_head;
+};
+
+/// Reads the samples of a ring created by the simulation. When the
+/// simulation creates the ring again, the reader maps the new ring and reads
+/// it from its oldest sample.
+class ShmRingReader final
+{
+public:
+    ShmRingReader();
+    ~ShmRingReader();
+
+    bool Open(const std::string& name, bool fromOldest = false);
+    void Close();
+
+    size_t Read(WireSample* samples, size_t max);
+    uint64_t GetLost() const;
+
+private:
+    ShmRingReader(const ShmRingReader&) = delete;
+    ShmRingReader& operator=(const ShmRingReader&) = delete;
+
+    bool Map(bool fromOldest);
+    void Unmap();
+    bool WasCreatedAgain() const;
+
+    std::string m_name;
+    dev_t m_device;
+    ino_t m_inode;
+    void* m_memory;
+    size_t m_size;
+    const ShmRingHeader* m_header;
+    const ShmRingSlot* m_slots;
+    uint64_t m_cursor;
+    uint64_t m_lost;
+};
@@ -0,0 +1,134 @@
+#include "subscription_hub.h"
+
+#include <algorithm>
+
+/// @brief Constructor of the Subscriber
+/// @param filter Channels and rate wanted by the subscriber
+Subscriber::Subscriber(SubscriptionFilter filter)
+    : m_filter(filter)
+{
+    if (m_filter.decimation == 0)
+    {
+        m_filter.decimation = 1;
+    }
+}
+
+/// @brief Keep the event if it passes the filter of the subscriber, the
+/// decimation and the status changes are followed per drone
+/// @param event Event published by the drone
+void Subscriber::Offer(const SubscriptionEvent& event)
+{
+    static const std::string NO_URI;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    SourceState& source = m_sources[event.uri ? *event.uri : NO_URI];
+    switch (event.channel)
+    {
+    case Channel::Telemetrics:
+        if (!m_filter.telemetrics ||
+            source.metricCount++ % m_filter.decimation != 0)
+        {
+            return;
+        }
+        break;
+    case Channel::Distances:
+        if (!m_filter.distances ||
+            source.distanceCount++ % m_filter.decimation != 0)
+        {
+            return;
+        }
+        break;
+    case Channel::Logs:
+        if (!m_filter.logs)
+        {
+            return;
+        }
+        break;
+    case Channel::Status:
+        if (!m_filter.status ||
+            (source.hasStatus && source.lastStatus == event.metric->status))
+        {
+            return;
+        }
+        source.hasStatus = true;
+        source.lastStatus = event.metric->status;
+        break;
+    }
+
+    // A slow subscriber loses its oldest events instead of growing forever
+    if (m_pending.size() >= MAX_PENDING)
+    {
+        m_pending.pop_front();
+    }
+    m_pending.push_back(event);
+
+    m_condition.notify_one();
+}
+
+/// @brief Wait for events and move them out of the subscriber
+/// @param events Filled with the pending events
+/// @param timeout Maximum time to wait
+/// @return True if there are events, False if the wait timed out
+bool Subscriber::Wait(
+    std::vector<SubscriptionEvent>* events, std::chrono::milliseconds timeout)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    if (!m_condition.wait_for(
+            lock, timeout, [this] { return !m_pending.empty(); }))
+    {
+        return false;
+    }
+
+    events->assign(
+        std::make_move_iterator(m_pending.begin()),
+        std::make_move_iterator(m_pending.end()));
+    m_pending.clear();
+
+    return true;
+}
+
+/// @brief Add a subscriber
+/// @param filter Channels and rate wanted by the subscriber
+/// @return Subscriber to wait on
+std::shared_ptr<Subscriber>
+SubscriptionHub::Subscribe(SubscriptionFilter filter)
+{
+    auto subscriber = std::make_shared<Subscriber>(filter);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_subscribers.push_back(subscriber);
+
+    return subscriber;
+}
+
+/// @brief Remove a subscriber
+/// @param subscriber Subscriber returned by Subscribe
+void SubscriptionHub::Unsubscribe(const std::shared_ptr<Subscriber>& subscriber)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_subscribers.erase(
+        std::remove(m_subscribers.begin(), m_subscribers.end(), subscriber),
+        m_subscribers.end());
+}
+
+/// @brief Check if anyone is subscribed, so samples are only built if needed
+/// @return True if there is at least one subscriber
+bool SubscriptionHub::HasSubscribers()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return !m_subscribers.empty();
+}
+
+/// @brief Offer an event to every subscriber
+/// @param event Event to publish
+void SubscriptionHub::Publish(const SubscriptionEvent& event)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    for (const auto& subscriber : m_subscribers)
+    {
+        subscriber->Offer(event);
+    }
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <struct/distance_reading.h>
+#include <struct/log.h>
+#include <struct/metric.h>
+
+enum class Channel
+{
+    Telemetrics,
+    Distances,
+    Logs,
+    Status
+};
+
+struct SubscriptionFilter
+{
+    bool telemetrics = false;
+    bool distances = false;
+    bool logs = false;
+    bool status = false;
+
+    // Only one sample out of decimation is kept for telemetrics and distances
+    unsigned int decimation = 1;
+};
+
+/// Sample shared by every subscriber, it is never copied per subscriber
+struct SubscriptionEvent
+{
+    Channel channel;
+    std::shared_ptr<const Metric> metric;
+    std::shared_ptr<const DistanceReadings> distance;
+    std::shared_ptr<const LogData> log;
+    // Drone of the sample, only set for the subscriptions to the swarm
+    std::shared_ptr<const std::string> uri;
+};
+
+class Subscriber final
+{
+public:
+    explicit Subscriber(SubscriptionFilter filter);
+
+    void Offer(const SubscriptionEvent& event);
+    bool Wait(
+        std::vector<SubscriptionEvent>* events,
+        std::chrono::milliseconds timeout);
+
+private:
+    static const size_t MAX_PENDING = 1024;
+
+    /// Decimation and status of the samples of one drone
+    struct SourceState
+    {
+        unsigned long metricCount = 0;
+        unsigned long distanceCount = 0;
+        int lastStatus = 0;
+        bool hasStatus = false;
+    };
+
+    SubscriptionFilter m_filter;
+    std::map<std::string, SourceState> m_sources;
+
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::deque<SubscriptionEvent> m_pending;
+};
+
+/// Fans the samples of a drone, or of the whole swarm, out to the
+/// subscribers that want them
+class SubscriptionHub final
+{
+public:
+    std::shared_ptr<Subscriber> Subscribe(SubscriptionFilter filter);
+    void Unsubscribe(const std::shared_ptr<Subscriber>& subscriber);
+    bool HasSubscribers();
+
+    void Publish(const SubscriptionEvent& event);
+
+private:
+    std::mutex m_mutex;
+    std::vector<std::shared_ptr<Subscriber>> m_subscribers;
+};
@@ -0,0 +1,170 @@
+/* Include the controller definition */
+#include "behavior_controller.h"
+
+/****************************************/
+/****************************************/
+
+template <typename TMove, typename TReturn, typename TDirection>
+const typename CBehaviorController<TMove, TReturn, TDirection>::SActionSteps
+    CBehaviorController<TMove, TReturn, TDirection>::s_actionSteps
+        [ACTION_COUNT] = {
+            /* None */ {nullptr, nullptr},
+            /* Identify */ {nullptr, nullptr},
+            /* Start */ {&CBehaviorController::StepTakeOff, nullptr},
+            /* Move */ {nullptr, &CBehaviorController::StepMove},
+            /* Stop */ {nullptr, &CBehaviorController::StepLand},
+            /* EmergencyStop */ {nullptr, &CBehaviorController::StepLand},
+            /* Return */ {nullptr, &CBehaviorController::StepReturn},
+            /* ChooseAngle */ {nullptr, nullptr},
+        };
+
+/// @brief Control the steps the drone has to follow
+template <typename TMove, typename TReturn, typename TDirection>
+void CBehaviorController<TMove, TReturn, TDirection>::ControlStep()
+{
+    Real batteryLevel;
+    if (!StartStep(batteryLevel))
+    {
+        return;
+    }
+
+    TActionStep step =
+        s_actionSteps[static_cast<size_t>(m_currentAction)].BeforeSensing;
+    if (step)
+    {
+        (this->*step)(batteryLevel);
+    }
+
+    ReadDistances();
+
+    // A step that changes the action hands over to the step of the new one,
+    // at most once per action so the steps cannot loop forever
+    for (size_t i = 0; i < ACTION_COUNT; ++i)
+    {
+        Action action = m_currentAction;
+        step = s_actionSteps[static_cast<size_t>(action)].AfterSensing;
+        if (!step)
+        {
+            break;
+        }
+
+        (this->*step)(batteryLevel);
+        if (m_currentAction == action)
+        {
+            break;
+        }
+    }
+
+    EndStep(batteryLevel);
+}
+
+/// @brief Handle the Move action
+/// @return True if action succeed, False if unsuccessful
+template <typename TMove, typename TReturn, typename TDirection>
+bool CBehaviorController<TMove, TReturn, TDirection>::Move()
+{
+    return TMove::Move(*this);
+}
+
+/// @brief Handle the return to base action
+/// @return False if arrived to base, True if not arrived to base
+template <typename TMove, typename TReturn, typename TDirection>
+bool CBehaviorController<TMove, TReturn, TDirection>::Return()
+{
+    return TReturn::Return(*this);
+}
+
+/// @brief Handle the Choose random angle action
+template <typename TMove, typename TReturn, typename TDirection>
+void CBehaviorController<TMove, TReturn, TDirection>::ChooseRandomAngle()
+{
+    TDirection::ChooseAngle(*this);
+}
+
+/// @brief Determine if the drone should change direction
+/// @return True if changing direction, False if not
+template <typename TMove, typename TReturn, typename TDirection>
+bool CBehaviorController<TMove, TReturn, TDirection>::ShouldChangeDirection()
+{
+    return TDirection::ShouldChangeDirection(*this);
+}
+
+/// @brief Lift the drone and choose its first angle at its height
+/// @param batteryLevel Battery level of the drone
+template <typename TMove, typename TReturn, typename TDirection>
+void CBehaviorController<TMove, TReturn, TDirection>::StepTakeOff(
+    Real batteryLevel)
+{
+    if (batteryLevel >= 0.3f && !TakeOff())
+    {
+        ChooseRandomAngle();
+        m_currentAction = Action::Move;
+    }
+}
+
+/// @brief Explore, and return at the latest moment the remaining charge
+/// allows it
+/// @param batteryLevel Battery level of the drone
+template <typename TMove, typename TReturn, typename TDirection>
+void CBehaviorController<TMove, TReturn, TDirection>::StepMove(
+    Real batteryLevel)
+{
+    Move();
+    if (m_energyModel.ShouldReturn(
+            batteryLevel, m_pcPos->GetReading().Position, m_cInitialPosition))
+    {
+        m_pendingLogs.emplace_back("Battery low, returning to base", "INFO");
+        m_currentAction = Action::Return;
+    }
+}
+
+/// @brief Return to the base, then land and tell the server the drone is
+/// done
+/// @param batteryLevel Battery level of the drone
+template <typename TMove, typename TReturn, typename TDirection>
+void CBehaviorController<TMove, TReturn, TDirection>::StepReturn(
+    Real batteryLevel)
+{
+    if (!Return())
+    {
+        if (!Land())
+        {
+            m_server.SendDone();
+        }
+    }
+}
+
+/// @brief Land the drone where it is
+/// @param batteryLevel Battery level of the drone
+template <typename TMove, typename TReturn, typename TDirection>
+void CBehaviorController<TMove, TReturn, TDirection>::StepLand(
+    Real batteryLevel)
+{
+    Land();
+}
+
+/****************************************/
+/****************************************/
+
+/* Random walk turning away from the walls, the original strategy */
+typedef CBehaviorController<CRandomWalk, CHomingReturn, CAwayFromWalls>
+    CMainSimulationController;
+
+/* Random walk turning to any angle at the walls */
+typedef CBehaviorController<CRandomWalk, CHomingReturn, CUniformTurn>
+    CUniformTurnController;
+
+/*
+ * This statement notifies ARGoS of the existence of the controller.
+ * It binds the class passed as first argument to the string passed as
+ * second argument.
+ * The string is then usable in the XML configuration file to refer to
+ * this controller.
+ * When ARGoS reads that string in the XML file, it knows which controller
+ * class to instantiate.
+ * See also the XML configuration files for an example of how this is used.
+ *
+ * A new strategy is added by registering its combination of policies here.
+ */
+REGISTER_CONTROLLER(CMainSimulationController, "main_simulation_controller")
+REGISTER_CONTROLLER(CUniformTurnController, "uniform_turn_controller")
@@ -0,0 +1,99 @@
+/*
+ * Controller of a drone, specialized at compile time by its behavior
+ * policies (behavior_policies.h).
+ *
+ * The move policy flies the drone while it explores, the return policy
+ * brings it back to its base and the direction policy chooses its angle.
+ * Every combination of policies is registered as its own ARGoS controller
+ * type in behavior_controller.cpp, so a strategy is chosen in the XML file
+ * by the name of the controller, and drones with different strategies can
+ * fly in the same swarm.
+ *
+ * The action of the drone is run through a table with a step per action,
+ * called before and after the distances are read. A step that changes the
+ * action hands the drone over to the step of the new action in the same
+ * tick. Neither the table nor the policies use virtual calls.
+ */
+
+#ifndef BEHAVIOR_CONTROLLER_H
+#define BEHAVIOR_CONTROLLER_H
+
+#include <main_simulation/behavior_policies.h>
+#include <main_simulation/main_simulation.h>
+
+/* Number of values of Action, in struct/command.h */
+static const size_t ACTION_COUNT =
+    static_cast<size_t>(Action::ChooseAngle) + 1;
+
+template <
+    typename TMovePolicy, typename TReturnPolicy, typename TDirectionPolicy>
+class CBehaviorController : public CMainSimulation
+{
+public:
+    /*
+     * This function is called once every time step.
+     * The length of the time step is set in the XML file.
+     */
+    virtual void ControlStep();
+
+    /*
+     * This function moves the drone until it meets a wall or other drone
+     */
+    bool Move();
+
+    /*
+     * This function returns the drone to the base
+     */
+    bool Return();
+
+    /*
+     * This function determines the next random angle the drone will travel in
+     */
+    void ChooseRandomAngle();
+
+    /*
+     * This function determines wether the direction should be changed when
+     * close to walls
+     */
+    bool ShouldChangeDirection();
+
+private:
+    /* The policies act on the state of the drone */
+    friend TMovePolicy;
+    friend TReturnPolicy;
+    friend TDirectionPolicy;
+
+    typedef void (CBehaviorController::*TActionStep)(Real batteryLevel);
+
+    /* Steps of an action, null when the action does nothing */
+    struct SActionSteps
+    {
+        TActionStep BeforeSensing;
+        TActionStep AfterSensing;
+    };
+
+    /*
+     * Lifts the drone, it starts to explore once it reached its height.
+     */
+    void StepTakeOff(Real batteryLevel);
+
+    /*
+     * Explores, until the energy model asks the drone to return.
+     */
+    void StepMove(Real batteryLevel);
+
+    /*
+     * Returns to the base, then lands.
+     */
+    void StepReturn(Real batteryLevel);
+
+    /*
+     * Lands where the drone is.
+     */
+    void StepLand(Real batteryLevel);
+
+    /* Steps of each action, indexed by the value of the action */
+    static const SActionSteps s_actionSteps[ACTION_COUNT];
+};
+
+#endif
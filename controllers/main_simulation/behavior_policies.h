@@ -0,0 +1,248 @@
+/*
+ * Behaviors of the drones, used as policies by CBehaviorController.
+ *
+ * A move policy flies the drone during the exploration, a return policy
+ * brings it back to its base and a direction policy chooses the angle of
+ * the walk and decides when to change it. The policies have no state of
+ * their own: they act on the drone they are given, which is the controller
+ * they are compiled in, so their calls are resolved at compile time.
+ *
+ * A policy reads and changes the protected state of CMainSimulation, the
+ * controller lets its policies do so.
+ */
+
+#ifndef BEHAVIOR_POLICIES_H
+#define BEHAVIOR_POLICIES_H
+
+#include <argos3/core/utility/logging/argos_log.h>
+#include <argos3/core/utility/math/angles.h>
+#include <argos3/core/utility/math/range.h>
+#include <argos3/core/utility/math/vector2.h>
+#include <argos3/core/utility/math/vector3.h>
+
+#include <main_simulation/main_simulation.h>
+
+using namespace argos;
+
+/*
+ * Walks straight at the angle of the drone, in steps, until the direction
+ * policy asks for a new angle.
+ */
+struct CRandomWalk
+{
+    template <typename TDrone>
+    static bool Move(TDrone& drone);
+};
+
+/*
+ * Heads straight to the base, and follows the direction policy for a few
+ * steps when a wall is in the way.
+ */
+struct CHomingReturn
+{
+    template <typename TDrone>
+    static bool Return(TDrone& drone);
+};
+
+/*
+ * Changes the angle when a wall is closer than the threshold, and chooses
+ * the new angle within 45 degrees of the direction away from the walls.
+ */
+struct CAwayFromWalls
+{
+    template <typename TDrone>
+    static void ChooseAngle(TDrone& drone);
+    template <typename TDrone>
+    static bool ShouldChangeDirection(TDrone& drone);
+};
+
+/*
+ * Changes the angle like CAwayFromWalls, but chooses any new angle.
+ */
+struct CUniformTurn : public CAwayFromWalls
+{
+    template <typename TDrone>
+    static void ChooseAngle(TDrone& drone);
+};
+
+/****************************************/
+/****************************************/
+
+/// @brief Move the drone at its angle, the next position is chosen when
+/// the drone gets close to the previous one
+/// @param drone Controller of the drone
+/// @return True if the drone keeps its direction, False if it changed
+template <typename TDrone>
+bool CRandomWalk::Move(TDrone& drone)
+{
+    float speed = 0.5f;
+    CVector3 cPos = drone.m_pcPos->GetReading().Position;
+
+    // If drone is close enough to intended position, choose next position
+    // Movement is done in steps like this so drone does not accelerate too much
+    // and clips into walls
+    if ((cPos - drone.m_nextPosition).Length() < 0.1f)
+    {
+        drone.m_nextPosition.SetX(
+            cPos.GetX() + Cos(drone.m_moveAngle) * speed);
+        drone.m_nextPosition.SetY(
+            cPos.GetY() + Sin(drone.m_moveAngle) * speed);
+    }
+
+    drone.m_pcPropellers->SetAbsolutePosition(
+        drone.m_nextPosition + drone.GetAvoidanceOffset());
+
+    if (drone.m_actionTime <= 0 && drone.ShouldChangeDirection())
+    {
+        drone.ChooseRandomAngle();
+        drone.m_actionTime = 10; // Timer is added to change direction check so
+                                 // a new angle isn't chosen every step when
+                                 // close to a wall
+        return false;
+    }
+    return true;
+}
+
+/// @brief Fly the drone to its base
+/// @param drone Controller of the drone
+/// @return False if arrived to base, True if not arrived to base
+template <typename TDrone>
+bool CHomingReturn::Return(TDrone& drone)
+{
+    CVector3 cPos = drone.m_pcPos->GetReading().Position;
+
+    CVector2 zeroVector = CVector2();
+    bool isAtBaseLocation = (cPos - drone.m_cInitialPosition)
+                                .ProjectOntoXY(zeroVector)
+                                .Length() < 0.5f;
+    if (isAtBaseLocation)
+    {
+        LOG << "ID = " << drone.GetId() << " - "
+            << "Arrived to base location..." << std::endl;
+        return false;
+    }
+
+    bool isCloseEnoughToIntendedPos =
+        (cPos - drone.m_nextPosition).Length() < 0.1f;
+    if (isCloseEnoughToIntendedPos)
+    {
+        LOG << "ID = " << drone.GetId() << " - "
+            << "Returning..." << std::endl;
+        float speed = 0.5f;
+
+        drone.m_nextPosition.SetX(
+            cPos.GetX() + Cos(drone.m_moveAngle) * speed);
+        drone.m_nextPosition.SetY(
+            cPos.GetY() + Sin(drone.m_moveAngle) * speed);
+    }
+
+    drone.m_pcPropellers->SetAbsolutePosition(
+        drone.m_nextPosition + drone.GetAvoidanceOffset());
+
+    if (drone.m_actionTime <= 0 && drone.ShouldChangeDirection())
+    {
+        drone.ChooseRandomAngle();
+        drone.m_actionTime = 10; // Timer is added to change direction check so
+                                 // a new angle isn't chosen every step when
+                                 // close to a wall
+    }
+    else
+    {
+        drone.m_moveAngle = ATan2(
+            drone.m_cInitialPosition.GetY() - cPos.GetY(),
+            drone.m_cInitialPosition.GetX() - cPos.GetX());
+    }
+
+    return true;
+}
+
+/// @brief Choose the next angle of the drone away from the close walls
+/// @param drone Controller of the drone
+template <typename TDrone>
+void CAwayFromWalls::ChooseAngle(TDrone& drone)
+{
+    const SensorDistance& distance = drone.m_distance;
+    float threshold = drone.m_distanceThreshold;
+    int wallsClose = 0;
+    float X = 0.0f;
+    float Y = 0.0f;
+
+    // If the wall is close enough, we add the inverse of the distance to a
+    // vector's coordinates. This vector then determines the range in which the
+    // new angle is chosen The left is the positive X direction, and back the
+    // positive Y
+    if (0.0f <= distance.front && distance.front <= threshold)
+    {
+        wallsClose++;
+        Y += 1.0f / distance.front;
+    }
+    if (0.0f <= distance.left && distance.left <= threshold)
+    {
+        wallsClose++;
+        X -= 1.0f / distance.left;
+    }
+    if (0.0f <= distance.back && distance.back <= threshold)
+    {
+        wallsClose++;
+        Y -= 1.0f / distance.back;
+    }
+    if (0.0f <= distance.right && distance.right <= threshold)
+    {
+        wallsClose++;
+        X += 1.0f / distance.right;
+    }
+
+    CRange<CRadians> range;
+    if (wallsClose == 0)
+    {
+        // If no walls are close, i.e. the drone just took off, choose a
+        // completely random direction
+        range = CRange(CRadians::ZERO, CRadians::TWO_PI);
+    }
+    else
+    {
+        // Else, find the angle of the vector above
+        CRadians angleRange = CRadians::PI_OVER_FOUR;
+        CRadians rangeCenter = ATan2(Y, X);
+        range = CRange(rangeCenter - angleRange, rangeCenter + angleRange);
+    }
+
+    drone.m_pendingLogs.emplace_back("Updating position", "INFO");
+    drone.m_nextPosition = drone.m_pcPos->GetReading().Position;
+    drone.m_moveAngle = drone.m_pcRNG->Uniform(range);
+}
+
+/// @brief Determine if the drone should change direction
+/// @param drone Controller of the drone
+/// @return True if a wall is closer than the threshold
+template <typename TDrone>
+bool CAwayFromWalls::ShouldChangeDirection(TDrone& drone)
+{
+    // Only public members, so the policies deriving from this one can use it
+    const SensorDistance& distance = drone.GetDistances();
+    float threshold = drone.GetDistanceThreshold();
+
+    if (0.0f <= distance.front && distance.front <= threshold)
+        return true;
+    if (0.0f <= distance.left && distance.left <= threshold)
+        return true;
+    if (0.0f <= distance.back && distance.back <= threshold)
+        return true;
+    if (0.0f <= distance.right && distance.right <= threshold)
+        return true;
+
+    return false;
+}
+
+/// @brief Choose any next angle, whatever the walls around the drone
+/// @param drone Controller of the drone
+template <typename TDrone>
+void CUniformTurn::ChooseAngle(TDrone& drone)
+{
+    drone.m_pendingLogs.emplace_back("Updating position", "INFO");
+    drone.m_nextPosition = drone.m_pcPos->GetReading().Position;
+    drone.m_moveAngle = drone.m_pcRNG->Uniform(
+        CRange<CRadians>(CRadians::ZERO, CRadians::TWO_PI));
+}
+
+#endif
@@ -0,0 +1,147 @@
+#include "energy_model.h"
+
+#include <algorithm>
+
+/// @brief Constructor of the CEnergyModel
+CEnergyModel::CEnergyModel()
+    : m_safetyMargin(0.05), m_pathFactor(1.5), m_fallbackThreshold(0.3)
+{
+    Reset();
+}
+
+/// @brief Set how conservative the prediction is
+/// @param safetyMargin Charge that must be left when landing at the base
+/// @param pathFactor Ratio between the path home and the straight line
+/// @param fallbackThreshold Charge at which to return until the drain is known
+void CEnergyModel::SetParameters(
+    Real safetyMargin, Real pathFactor, Real fallbackThreshold)
+{
+    m_safetyMargin = safetyMargin;
+    m_pathFactor = std::max<Real>(pathFactor, 1.0);
+    m_fallbackThreshold = fallbackThreshold;
+}
+
+/// @brief Forget every observed step
+void CEnergyModel::Reset()
+{
+    m_hasPrevious = false;
+    m_previousCharge = 0;
+    m_previousPosition = CVector3();
+    m_samples = 0;
+    m_sumWeight = 0;
+    m_sumDistance = 0;
+    m_sumDrain = 0;
+    m_sumDistanceSquared = 0;
+    m_sumDistanceDrain = 0;
+    m_flownDistance = 0;
+    m_movingDistance = 0;
+    m_movingSteps = 0;
+}
+
+/// @brief Forget the previous reading, so the drain of the steps that were
+/// not observed is not taken as the drain of a single step
+void CEnergyModel::Interrupt() { m_hasPrevious = false; }
+
+/// @brief Add the battery reading and position of the current step
+/// @param charge Available charge, between 0 and 1
+/// @param position Current position of the drone
+void CEnergyModel::Update(Real charge, const CVector3& position)
+{
+    if (m_hasPrevious)
+    {
+        Real distance = (position - m_previousPosition).Length();
+        Real drain = std::max<Real>(m_previousCharge - charge, 0.0);
+
+        m_sumWeight = m_sumWeight * FORGETTING_FACTOR + 1;
+        m_sumDistance = m_sumDistance * FORGETTING_FACTOR + distance;
+        m_sumDrain = m_sumDrain * FORGETTING_FACTOR + drain;
+        m_sumDistanceSquared =
+            m_sumDistanceSquared * FORGETTING_FACTOR + distance * distance;
+        m_sumDistanceDrain =
+            m_sumDistanceDrain * FORGETTING_FACTOR + distance * drain;
+        ++m_samples;
+
+        m_flownDistance += distance;
+        if (distance > MIN_MOVE)
+        {
+            m_movingDistance += distance;
+            ++m_movingSteps;
+        }
+    }
+
+    m_hasPrevious = true;
+    m_previousCharge = charge;
+    m_previousPosition = position;
+}
+
+/// @brief Predict the charge needed to fly back to base and land
+/// @param position Current position of the drone
+/// @param base Position of the base
+/// @return Charge needed, between 0 and 1
+Real CEnergyModel::EstimateReturnCharge(
+    const CVector3& position, const CVector3& base) const
+{
+    Real perStep;
+    Real perMeter;
+    GetDrain(&perStep, &perMeter);
+
+    CVector3 toBase = base - position;
+    toBase.SetZ(0);
+    Real straightLine = toBase.Length();
+
+    // Obstacles make the path longer than the straight line, but it is never
+    // longer than the distance already flown from the base
+    Real path = std::max(
+        straightLine, std::min(straightLine * m_pathFactor, m_flownDistance));
+    Real landing = position.GetZ();
+
+    Real speed = m_movingSteps > 0 ? m_movingDistance / m_movingSteps : 0;
+    Real steps = speed > 0 ? (path + landing) / speed : 0;
+
+    return steps * perStep + (path + landing) * perMeter;
+}
+
+/// @brief Determine if returning any later would not be safe
+/// @param charge Available charge, between 0 and 1
+/// @param position Current position of the drone
+/// @param base Position of the base
+/// @return True if the drone should return now
+bool CEnergyModel::ShouldReturn(
+    Real charge, const CVector3& position, const CVector3& base) const
+{
+    if (m_samples < MIN_SAMPLES)
+    {
+        return charge < m_fallbackThreshold;
+    }
+
+    return charge - EstimateReturnCharge(position, base) <= m_safetyMargin;
+}
+
+/// @brief Get the drain per step and per meter from the least-squares fit
+/// @param perStep Charge drained each step, even without moving
+/// @param perMeter Charge drained for each meter moved
+void CEnergyModel::GetDrain(Real* perStep, Real* perMeter) const
+{
+    *perStep = 0;
+    *perMeter = 0;
+
+    if (m_sumWeight <= 0)
+    {
+        return;
+    }
+
+    Real meanDistance = m_sumDistance / m_sumWeight;
+    Real meanDrain = m_sumDrain / m_sumWeight;
+    Real variance =
+        m_sumDistanceSquared / m_sumWeight - meanDistance * meanDistance;
+
+    // Without enough variation in the moves, all the drain is put on time
+    if (variance > 1e-9)
+    {
+        Real covariance =
+            m_sumDistanceDrain / m_sumWeight - meanDistance * meanDrain;
+        *perMeter = std::max<Real>(covariance / variance, 0.0);
+    }
+
+    *perStep = std::max<Real>(meanDrain - *perMeter * meanDistance, 0.0);
+}
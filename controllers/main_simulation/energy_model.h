@@ -0,0 +1,96 @@
+/*
+ * Energy prediction for the return to base.
+ *
+ * The drain of the battery is learned online from the readings of the
+ * battery sensor. With the time_motion battery model, the charge lost each
+ * step is a constant plus a term proportional to the distance moved, so both
+ * terms are estimated with a least-squares fit that slowly forgets old steps.
+ * The charge needed to get back to base is then predicted from the distance
+ * to the base, the estimated length of the path and the observed speed.
+ */
+
+#ifndef ENERGY_MODEL_H
+#define ENERGY_MODEL_H
+
+#include <argos3/core/utility/math/vector3.h>
+
+using namespace argos;
+
+class CEnergyModel
+{
+public:
+    CEnergyModel();
+
+    /*
+     * Sets how conservative the prediction is.
+     * safetyMargin: charge that must be left when landing at the base
+     * pathFactor: ratio between the path home and the straight line
+     * fallbackThreshold: charge at which to return until the drain is known
+     */
+    void SetParameters(
+        Real safetyMargin, Real pathFactor, Real fallbackThreshold);
+
+    /*
+     * Forgets everything that was observed.
+     */
+    void Reset();
+
+    /*
+     * Forgets the previous reading, after steps that were not observed.
+     */
+    void Interrupt();
+
+    /*
+     * Adds the reading of the current step.
+     */
+    void Update(Real charge, const CVector3& position);
+
+    /*
+     * Predicts the charge needed to fly back to base and land.
+     */
+    Real EstimateReturnCharge(
+        const CVector3& position, const CVector3& base) const;
+
+    /*
+     * Returns true when returning any later would not be safe.
+     */
+    bool ShouldReturn(
+        Real charge, const CVector3& position, const CVector3& base) const;
+
+private:
+    /* Steps needed before the fit is trusted */
+    static const UInt32 MIN_SAMPLES = 20;
+
+    /* Weight of the old steps in the fit, closer to 1 forgets slower */
+    static constexpr Real FORGETTING_FACTOR = 0.995;
+
+    /* Moves shorter than this are not used to estimate the speed */
+    static constexpr Real MIN_MOVE = 1e-3;
+
+    void GetDrain(Real* perStep, Real* perMeter) const;
+
+    Real m_safetyMargin;
+    Real m_pathFactor;
+    Real m_fallbackThreshold;
+
+    bool m_hasPrevious;
+    Real m_previousCharge;
+    CVector3 m_previousPosition;
+    UInt32 m_samples;
+
+    /* Weighted sums of the fit: charge drained against distance moved */
+    Real m_sumWeight;
+    Real m_sumDistance;
+    Real m_sumDrain;
+    Real m_sumDistanceSquared;
+    Real m_sumDistanceDrain;
+
+    /* Distance flown since the reset, an upper bound of the path home */
+    Real m_flownDistance;
+
+    /* Distance and steps while moving, to estimate the speed */
+    Real m_movingDistance;
+    UInt32 m_movingSteps;
+};
+
+#endif
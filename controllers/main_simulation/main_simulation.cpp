@@ -7,6 +7,10 @@
 #include <argos3/core/utility/math/vector2.h>
 /* Logging */
 #include <argos3/core/utility/logging/argos_log.h>
+/* Experiment random seed */
+#include <argos3/core/simulator/simulator.h>
+/* Neighbor drones */
+#include <main_simulation/spatial_hash.h>
 
 template <typename E>
 constexpr auto toUnderlyingType(E e)
@@ -14,6 +18,23 @@ constexpr auto toUnderlyingType(E e)
     return static_cast<typename std::underlying_type<E>::type>(e);
 }
 
+/// @brief Derive a drone's rng seed from the experiment seed and its full id
+/// @param experimentSeed Seed set in the experiment configuration
+/// @param id Entity id of the drone
+/// @return Seed that is unique per drone and reproducible across runs
+static UInt32 deriveSeed(UInt32 experimentSeed, const std::string& id)
+{
+    // FNV-1a over the whole id, so "fly1" and "fly11" do not collide
+    UInt32 hash = 2166136261u;
+    for (char c : id)
+    {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 16777619u;
+    }
+    return experimentSeed ^
+           (hash + 0x9e3779b9u + (experimentSeed << 6) + (experimentSeed >> 2));
+}
+
 /****************************************/
 /****************************************/
 
@@ -21,20 +42,74 @@ constexpr auto toUnderlyingType(E e)
 CMainSimulation::CMainSimulation()
     : m_pcDistance(NULL), m_pcPropellers(NULL), m_pcRNG(NULL), m_pcRABA(NULL),
       m_pcRABS(NULL), m_pcPos(NULL), m_pcBattery(NULL), m_uiCurrentStep(0),
-      m_actionTime(0), m_currentAction(Action::None), m_server()
+      m_actionTime(0), m_currentAction(Action::None), m_autoStart(false),
+      m_avoidanceRadius(0.5), m_avoidanceGain(0.0), m_unHeartbeatPeriod(0),
+      m_unDormantSteps(0), m_bPublishing(true), m_unSlot(0), m_server()
 {
 }
 
-/// @brief Initialise the sensors and start the server
+/// @brief Initialise the sensors and prepare the server, the servers of every
+/// drone are started together by the loop functions
 /// @param t_node
 void CMainSimulation::Init(TConfigurationNode& t_node)
 {
-    std::string id = GetId();
-    unsigned int port = 9854 + stoi(id.substr(id.length() - 1));
+    // Start the mission without waiting for the backend (headless runs)
+    GetNodeAttributeOrDefault(t_node, "autostart", m_autoStart, false);
 
-    std::string address = "0.0.0.0:" + std::to_string(port);
+    // Parameters of the predictive return to base
+    if (NodeExists(t_node, "energy"))
+    {
+        TConfigurationNode& energyNode = GetNode(t_node, "energy");
+        Real safetyMargin = 0.05;
+        Real pathFactor = 1.5;
+        Real fallbackThreshold = 0.3;
+        GetNodeAttributeOrDefault(
+            energyNode, "safety_margin", safetyMargin, safetyMargin);
+        GetNodeAttributeOrDefault(
+            energyNode, "path_factor", pathFactor, pathFactor);
+        GetNodeAttributeOrDefault(
+            energyNode, "fallback_threshold", fallbackThreshold,
+            fallbackThreshold);
+        m_energyModel.SetParameters(
+            safetyMargin, pathFactor, fallbackThreshold);
+    }
+
+    // Repulsion from the other drones, needs the main loop functions
+    if (NodeExists(t_node, "avoidance"))
+    {
+        TConfigurationNode& avoidanceNode = GetNode(t_node, "avoidance");
+        GetNodeAttributeOrDefault(
+            avoidanceNode, "radius", m_avoidanceRadius, m_avoidanceRadius);
+        GetNodeAttributeOrDefault(
+            avoidanceNode, "gain", m_avoidanceGain, m_avoidanceGain);
+    }
+
+    // Idle drones only read their sensors every heartbeat_period steps, they
+    // never sleep without the node
+    if (NodeExists(t_node, "dormant"))
+    {
+        GetNodeAttributeOrDefault(
+            GetNode(t_node, "dormant"), "heartbeat_period",
+            m_unHeartbeatPeriod, m_unHeartbeatPeriod);
+    }
+
+    // Port of the drone in slot 0, changed for each shard of a sharded run
+    unsigned int basePort = 9854;
+    GetNodeAttributeOrDefault(t_node, "base_port", basePort, basePort);
 
-    m_server.Run(address);
+    // The slot is taken from the full id, so every drone gets its own port
+    unsigned int port = DroneRegistry::GetInstance().Register(
+        GetId(), basePort, &m_server);
+    if (port == 0)
+    {
+        THROW_ARGOSEXCEPTION(
+            "No port left for drone \"" << GetId() << "\" from base_port "
+                                        << basePort);
+    }
+    m_unSlot = port - basePort;
+
+    std::string address = "0.0.0.0:" + std::to_string(port);
+    m_server.Configure(address, ReadServerOptions(t_node));
 
     try
     {
@@ -80,54 +155,124 @@ void CMainSimulation::Init(TConfigurationNode& t_node)
     Reset();
 }
 
-/// @brief Control the steps the drone has to follow
-void CMainSimulation::ControlStep()
+/// @brief Read the options of the server from the <server> node of the
+/// parameters, the defaults are kept for the missing attributes
+/// @param t_node Parameters of the controller
+/// @return Options of the server
+ServerOptions CMainSimulation::ReadServerOptions(TConfigurationNode& t_node)
 {
-    HandleAction(); // Comment to test takeoff without backend
-
-    argos::Real batteryLevel = m_pcBattery->GetReading().AvailableCharge;
-
-    m_server.UpdateTelemetrics(getCurrentMetric(batteryLevel));
+    ServerOptions options;
+    if (!NodeExists(t_node, "server"))
+    {
+        return options;
+    }
 
-    // Takeoff
-    if (m_currentAction == Action::Start && batteryLevel >= 0.3f)
+    TConfigurationNode& serverNode = GetNode(t_node, "server");
+    GetNodeAttributeOrDefault(
+        serverNode, "max_message_size", options.max_message_size,
+        options.max_message_size);
+    GetNodeAttributeOrDefault(
+        serverNode, "keepalive_time_ms", options.keepalive_time_ms,
+        options.keepalive_time_ms);
+    GetNodeAttributeOrDefault(
+        serverNode, "keepalive_timeout_ms", options.keepalive_timeout_ms,
+        options.keepalive_timeout_ms);
+    GetNodeAttributeOrDefault(
+        serverNode, "max_connection_idle_ms", options.max_connection_idle_ms,
+        options.max_connection_idle_ms);
+    GetNodeAttributeOrDefault(
+        serverNode, "min_pollers", options.min_pollers, options.min_pollers);
+    GetNodeAttributeOrDefault(
+        serverNode, "max_pollers", options.max_pollers, options.max_pollers);
+    GetNodeAttributeOrDefault(
+        serverNode, "max_threads", options.max_threads, options.max_threads);
+    GetNodeAttributeOrDefault(
+        serverNode, "history_segment_size", options.history_segment_size,
+        options.history_segment_size);
+    GetNodeAttributeOrDefault(
+        serverNode, "history_segments", options.history_segments,
+        options.history_segments);
+
+    UInt32 quotaMegabytes = 0;
+    GetNodeAttributeOrDefault(
+        serverNode, "resource_quota_mb", quotaMegabytes, quotaMegabytes);
+    options.resource_quota_bytes =
+        static_cast<size_t>(quotaMegabytes) * 1024 * 1024;
+
+    std::string compression = "none";
+    GetNodeAttributeOrDefault(
+        serverNode, "compression", compression, compression);
+    if (!ParseCompression(compression, &options.bulk_compression))
     {
-        if (!TakeOff())
-        {
-            m_currentAction = Action::Move;
-        }
+        THROW_ARGOSEXCEPTION(
+            "Unknown compression \"" << compression
+                                     << "\", use none, gzip or deflate");
     }
 
-    GetDistanceReadings();
-    m_server.UpdateDistances(DistanceReadings(
-        m_distance.front, m_distance.back, m_distance.left, m_distance.right,
-        getCurrentPosition()));
+    return options;
+}
 
-    if (m_currentAction == Action::Move)
+/// @brief Start the step of the drone, the action itself is run by the
+/// behavior policies of the controller
+/// @param batteryLevel Set to the battery level, when the drone is awake
+/// @return False if the drone sleeps at this step
+bool CMainSimulation::StartStep(Real& batteryLevel)
+{
+    // The loop functions start every server together before the first step,
+    // a drone run without them starts its own server here
+    if (!m_server.IsRunning() && !m_server.Start())
     {
-        Move();
-        if (batteryLevel < 0.3f)
-        {
-            m_currentAction = Action::Return;
-        }
+        THROW_ARGOSEXCEPTION(
+            "Could not start the server of drone \"" << GetId() << "\"");
     }
 
-    if (m_currentAction == Action::Stop)
+    // Emergency stop is applied this step, before the commands queue
+    if (m_server.TakeEmergencyStop())
     {
-        Land();
+        m_currentAction = Action::EmergencyStop;
     }
 
-    if (m_currentAction == Action::Return)
+    // An idle drone sleeps until a command wakes it up, it only reads its
+    // sensors and publishes its state at the heartbeat
+    if (IsIdle() && !m_server.HasCommand())
     {
-        if (!Return())
+        if (m_unDormantSteps == 0)
         {
-            if (!Land())
-            {
-                m_server.SendDone();
-            }
+            m_energyModel.Interrupt();
+        }
+
+        m_bPublishing = ++m_unDormantSteps % m_unHeartbeatPeriod == 0;
+        if (m_bPublishing)
+        {
+            m_lastMetric =
+                getCurrentMetric(m_pcBattery->GetReading().AvailableCharge);
+            ReadDistances();
         }
+
+        m_uiCurrentStep++;
+        return false;
     }
 
+    m_unDormantSteps = 0;
+    m_bPublishing = true;
+
+    if (m_currentAction != Action::EmergencyStop)
+    {
+        HandleAction(); // Comment to test takeoff without backend
+    }
+
+    batteryLevel = m_pcBattery->GetReading().AvailableCharge;
+    m_energyModel.Update(batteryLevel, m_pcPos->GetReading().Position);
+
+    m_lastMetric = getCurrentMetric(batteryLevel);
+
+    return true;
+}
+
+/// @brief End the step of the drone once its action ran
+/// @param batteryLevel Battery level read at the start of the step
+void CMainSimulation::EndStep(Real batteryLevel)
+{
     // Print current position.
     LOG << "ID = " << GetId() << " - "
         << "Position (x,y,z) = (" << m_pcPos->GetReading().Position.GetX()
@@ -159,7 +304,7 @@ void CMainSimulation::ControlStep()
 }
 
 /// @brief Handle the Take off action
-/// @return True if action succeed, False if unsuccessful
+/// @return False once the drone reached its height, True while it climbs
 bool CMainSimulation::TakeOff()
 {
     LOG << "ID = " << GetId() << " - "
@@ -173,7 +318,6 @@ bool CMainSimulation::TakeOff()
     if (cPos.GetZ() >= takeOffHeight - takeoffPrecision)
     {
         m_cInitialPosition = cPos;
-        ChooseRandomAngle();
         return false;
     }
     cPos.SetZ(takeOffHeight);
@@ -181,51 +325,6 @@ bool CMainSimulation::TakeOff()
     return true;
 }
 
-/// @brief Handle the return to base action
-/// @return False if arrived to base, True if not arrived to base
-bool CMainSimulation::Return()
-{
-    CVector3 cPos = m_pcPos->GetReading().Position;
-
-    CVector2 zeroVector = CVector2();
-    bool isAtBaseLocation =
-        (cPos - m_cInitialPosition).ProjectOntoXY(zeroVector).Length() < 0.5f;
-    if (isAtBaseLocation)
-    {
-        LOG << "ID = " << GetId() << " - "
-            << "Arrived to base location..." << std::endl;
-        return false;
-    }
-
-    bool isCloseEnoughToIntendedPos = (cPos - m_nextPosition).Length() < 0.1f;
-    if (isCloseEnoughToIntendedPos)
-    {
-        LOG << "ID = " << GetId() << " - "
-            << "Returning..." << std::endl;
-        float speed = 0.5f;
-
-        m_nextPosition.SetX(cPos.GetX() + Cos(m_moveAngle) * speed);
-        m_nextPosition.SetY(cPos.GetY() + Sin(m_moveAngle) * speed);
-    }
-
-    m_pcPropellers->SetAbsolutePosition(m_nextPosition);
-
-    if (m_actionTime <= 0 && ShouldChangeDirection())
-    {
-        ChooseRandomAngle();
-        m_actionTime = 10; // Timer is added to change direction check so a new
-                           // angle isn't chosen every step when close to a wall
-    }
-    else
-    {
-        m_moveAngle = ATan2(
-            m_cInitialPosition.GetY() - cPos.GetY(),
-            m_cInitialPosition.GetX() - cPos.GetX());
-    }
-
-    return true;
-}
-
 /// @brief Handle the Land action
 /// @return True if action succeed, False if unsuccessful
 bool CMainSimulation::Land()
@@ -246,84 +345,38 @@ bool CMainSimulation::Land()
     return true;
 }
 
-/// @brief Handle the Choose random angle action
-void CMainSimulation::ChooseRandomAngle()
+/// @brief Get the offset pushing the drone away from the drones that are too
+/// close, the intended position itself is not changed
+/// @return Offset to add to the intended position
+CVector3 CMainSimulation::GetAvoidanceOffset()
 {
-    int wallsClose = 0;
-    float X = 0.0f;
-    float Y = 0.0f;
-
-    // If the wall is close enough, we add the inverse of the distance to a
-    // vector's coordinates. This vector then determines the range in which the
-    // new angle is chosen The left is the positive X direction, and back the
-    // positive Y
-    if (0.0f <= m_distance.front && m_distance.front <= m_distanceThreshold)
-    {
-        wallsClose++;
-        Y += 1.0f / m_distance.front;
-    }
-    if (0.0f <= m_distance.left && m_distance.left <= m_distanceThreshold)
-    {
-        wallsClose++;
-        X -= 1.0f / m_distance.left;
-    }
-    if (0.0f <= m_distance.back && m_distance.back <= m_distanceThreshold)
+    CVector3 offset;
+    if (m_avoidanceGain <= 0.0f)
     {
-        wallsClose++;
-        Y -= 1.0f / m_distance.back;
+        return offset;
     }
-    if (0.0f <= m_distance.right && m_distance.right <= m_distanceThreshold)
-    {
-        wallsClose++;
-        X += 1.0f / m_distance.right;
-    }
-
-    CRange<CRadians> range;
-    if (wallsClose == 0)
-    {
-        // If no walls are close, i.e. the drone just took off, choose a
-        // completely random direction
-        range = CRange(CRadians::ZERO, CRadians::TWO_PI);
-    }
-    else
-    {
-        // Else, find the angle of the vector above
-        CRadians angleRange = CRadians::PI_OVER_FOUR;
-        CRadians rangeCenter = ATan2(Y, X);
-        range = CRange(rangeCenter - angleRange, rangeCenter + angleRange);
-    }
-
-    m_server.AddLog("Updating position", "INFO");
-    m_nextPosition = m_pcPos->GetReading().Position;
-    m_moveAngle = m_pcRNG->Uniform(range);
-}
 
-/// @brief Handle the Move action
-/// @return True if action succeed, False if unsuccessful
-bool CMainSimulation::Move()
-{
-    float speed = 0.5f;
     CVector3 cPos = m_pcPos->GetReading().Position;
+    const void* self = static_cast<const CCI_Controller*>(this);
 
-    // If drone is close enough to intended position, choose next position
-    // Movement is done in steps like this so drone does not accelerate too much
-    // and clips into walls
-    if ((cPos - m_nextPosition).Length() < 0.1f)
-    {
-        m_nextPosition.SetX(cPos.GetX() + Cos(m_moveAngle) * speed);
-        m_nextPosition.SetY(cPos.GetY() + Sin(m_moveAngle) * speed);
-    }
+    CSpatialHash::GetInstance().ForEachNeighbor(
+        cPos, m_avoidanceRadius,
+        [&](const CSpatialHash::SEntry& neighbor)
+        {
+            CVector3 away = cPos - neighbor.Position;
+            away.SetZ(0.0f);
+            Real distance = away.Length();
+            if (neighbor.Owner == self || distance < 1e-6)
+            {
+                return;
+            }
 
-    m_pcPropellers->SetAbsolutePosition(m_nextPosition);
+            // Closer drones push harder
+            offset += away / distance *
+                      ((m_avoidanceRadius - distance) / m_avoidanceRadius);
+        });
 
-    if (m_actionTime <= 0 && ShouldChangeDirection())
-    {
-        ChooseRandomAngle();
-        m_actionTime = 10; // Timer is added to change direction check so a new
-                           // angle isn't chosen every step when close to a wall
-        return false;
-    }
-    return true;
+    return offset * m_avoidanceGain;
 }
 
 /// @brief Get the distances
@@ -332,7 +385,7 @@ void CMainSimulation::GetDistanceReadings()
     // Look here for documentation on the distance sensor:
     // https://github.com/MISTLab/argos3/blob/inf3995/src/plugins/robots/crazyflie/control_interface/ci_crazyflie_distance_scanner_sensor.h
     // Read distance sensor measurements
-    CCI_CrazyflieDistanceScannerSensor::TReadingsMap sDistRead =
+    const CCI_CrazyflieDistanceScannerSensor::TReadingsMap& sDistRead =
         m_pcDistance->GetReadingsMap(); // Do not use GetLongReadingsMap,
                                         // doesn't work and reads nothing
 
@@ -352,43 +405,59 @@ void CMainSimulation::GetDistanceReadings()
     }
 }
 
-/// @brief Determine if the drone should change direction
-/// @return True if changing direction, False if not
-bool CMainSimulation::ShouldChangeDirection()
+/// @brief Read the distance sensor and keep the readings published at this
+/// step
+void CMainSimulation::ReadDistances()
 {
-    if (0.0f <= m_distance.front && m_distance.front <= m_distanceThreshold)
-        return true;
-    if (0.0f <= m_distance.left && m_distance.left <= m_distanceThreshold)
-        return true;
-    if (0.0f <= m_distance.back && m_distance.back <= m_distanceThreshold)
-        return true;
-    if (0.0f <= m_distance.right && m_distance.right <= m_distanceThreshold)
-        return true;
-
-    return false;
+    GetDistanceReadings();
+    m_lastDistances = DistanceReadings(
+        m_distance.front, m_distance.back, m_distance.left, m_distance.right,
+        getCurrentPosition());
+}
+
+/// @brief Check if the drone can sleep, it is landed and has nothing to do
+/// @return True if the drone is idle
+bool CMainSimulation::IsIdle() const
+{
+    return m_unHeartbeatPeriod > 0 && m_currentAction == Action::None &&
+           m_actionTime <= 0;
 }
 
+/// @brief Check if the state of the drone changed at this step, a sleeping
+/// drone only publishes it at the heartbeat
+/// @return True if the loop functions should publish the state
+bool CMainSimulation::IsPublishing() const { return m_bPublishing; }
+
+/// @brief Check if the drone slept at its last step, it is landed and does
+/// not move until a command wakes it up
+/// @return True if the drone is asleep
+bool CMainSimulation::IsDormant() const { return m_unDormantSteps > 0; }
+
 /// @brief Reset the drone
 void CMainSimulation::Reset()
 {
-    // Reset rng seed
+    // Reset rng seed, the same experiment seed always gives the same run
     m_pcRNG->SetSeed(
-        std::time(0) +
-        stoi(GetId().substr(
-            GetId().length() - 1))); // Drone ID is taken into account so both
-                                     // drones have different rng
+        deriveSeed(CSimulator::GetInstance().GetRandomSeed(), GetId()));
     m_pcRNG->Reset();
 
     m_uiCurrentStep = 0;
-    // m_currentAction = Action::Start; // Comment when doing merge request
-    m_currentAction = Action::None; // Comment when testing without backend
+    m_currentAction = m_autoStart ? Action::Start : Action::None;
     m_actionTime = 5;
     m_distance = SensorDistance();
     m_distanceThreshold = 20.0f;
+    m_energyModel.Reset();
+    m_unDormantSteps = 0;
+    m_bPublishing = true;
 }
 
 /// @brief Stop the server
-void CMainSimulation::Destroy() { m_server.Stop(); }
+void CMainSimulation::Destroy()
+{
+    // Unregistered first so group commands stop waiting on this drone
+    DroneRegistry::GetInstance().Unregister(GetId());
+    m_server.Stop();
+}
 
 /// @brief Determine wich action should be done by the command
 void CMainSimulation::HandleAction()
@@ -402,6 +471,44 @@ void CMainSimulation::HandleAction()
     }
 }
 
+/// @brief Get the action the drone is currently executing
+/// @return Current action
+Action CMainSimulation::GetCurrentAction() const { return m_currentAction; }
+
+/// @brief Get the last readings of the distance scanner
+/// @return Distances, in cm
+const SensorDistance& CMainSimulation::GetDistances() const
+{
+    return m_distance;
+}
+
+/// @brief Get the distance to a wall under which the drone changes direction
+/// @return Threshold, in cm
+float CMainSimulation::GetDistanceThreshold() const
+{
+    return m_distanceThreshold;
+}
+
+/// @brief Get the state of the drone at this step and hand over the logs
+/// written since the last call, used by the loop functions to build the frame
+/// of the tick
+/// @param frame Frame of the drone to fill
+void CMainSimulation::FillFrame(DroneFrame* frame)
+{
+    frame->metric = m_lastMetric;
+    frame->distance = m_lastDistances;
+    frame->logs.swap(m_pendingLogs);
+    m_pendingLogs.clear();
+}
+
+/// @brief Get the server of the drone
+/// @return Server of the drone
+SimulationServer& CMainSimulation::GetServer() { return m_server; }
+
+/// @brief Get the slot assigned to the drone by the registry
+/// @return Slot of the drone
+UInt32 CMainSimulation::GetSlot() const { return m_unSlot; }
+
 /// @brief Get the current position of the drone
 /// @return Position of the drone
 Position CMainSimulation::getCurrentPosition()
@@ -419,15 +526,3 @@ Metric CMainSimulation::getCurrentMetric(float batteryLevel)
         toUnderlyingType(m_currentAction), position,
         batteryLevel * 100.0f); // Multiply battery by 100 to get percentage
 }
-
-/*
- * This statement notifies ARGoS of the existence of the controller.
- * It binds the class passed as first argument to the string passed as
- * second argument.
- * The string is then usable in the XML configuration file to refer to
- * this controller.
- * When ARGoS reads that string in the XML file, it knows which controller
- * class to instantiate.
- * See also the XML configuration files for an example of how this is used.
- */
-REGISTER_CONTROLLER(CMainSimulation, "main_simulation_controller")
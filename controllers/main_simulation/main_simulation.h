@@ -32,8 +32,11 @@
 #include <argos3/core/utility/math/rng.h>
 
 #include <communication/server.h>
+#include <main_simulation/energy_model.h>
 #include <struct/distance_reading.h>
+#include <struct/log.h>
 #include <struct/position.h>
+#include <struct/tick_frame.h>
 
 struct SensorDistance
 {
@@ -58,6 +61,14 @@ using namespace argos;
 
 /*
  * A controller is simply an implementation of the CCI_Controller class.
+ * The state of the drone is sent to its server by the main loop functions
+ * (loop_functions/main_simulation) at the end of each tick.
+ *
+ * This class holds what every drone shares: sensors, server, commands,
+ * energy model and the state published to the loop functions. How the drone
+ * explores and returns to its base is given by the policies of
+ * CBehaviorController (behavior_controller.h), which implements ControlStep()
+ * and registers one controller type per combination of policies.
  */
 class CMainSimulation : public CCI_Controller
 {
@@ -74,12 +85,6 @@ public:
      */
     virtual void Init(TConfigurationNode& t_node);
 
-    /*
-     * This function is called once every time step.
-     * The length of the time step is set in the XML file.
-     */
-    virtual void ControlStep();
-
     /*
      * This function resets the controller to its state right after the
      * Init().
@@ -101,12 +106,8 @@ public:
     bool Start();
 
     /*
-     * This function returns the drone to the base
-     */
-    bool Return();
-
-    /*
-     * This function lifts the drone from the ground
+     * This function lifts the drone from the ground, and keeps its position
+     * as the base once it reached its height
      */
     bool TakeOff();
 
@@ -121,37 +122,84 @@ public:
     bool Land();
 
     /*
-     * This function determines the next random angle the drone will travel in
+     * This function computes the repulsion from the neighbor drones
      */
-    void ChooseRandomAngle();
+    CVector3 GetAvoidanceOffset();
 
     /*
-     * This function moves the drone until it meets a wall or other drone
+     * This function gets the distance readings and saves them in a struct
      */
-    bool Move();
+    void GetDistanceReadings();
 
     /*
-     * This function gets the distance readings and saves them in a struct
+     * This function reads the distances and keeps them for the frame
      */
-    void GetDistanceReadings();
+    void ReadDistances();
 
     /*
-     * This function determines wether the direction should be changed when
-     * close to walls
+     * This function checks if the drone has nothing to do and can sleep
      */
-    bool ShouldChangeDirection();
+    bool IsIdle() const;
 
     void HandleAction();
 
+    Action GetCurrentAction() const;
+
+    const SensorDistance& GetDistances() const;
+
+    /*
+     * Distance to a wall under which the drone changes its direction
+     */
+    float GetDistanceThreshold() const;
+
+    /*
+     * This function gives the state of the drone to the loop functions, the
+     * controller itself never sends anything to the server
+     */
+    void FillFrame(DroneFrame* frame);
+
+    SimulationServer& GetServer();
+
+    UInt32 GetSlot() const;
+
+    /*
+     * Whether the state of the drone must be published at this step, an
+     * idle drone only publishes it at the heartbeat
+     */
+    bool IsPublishing() const;
+
+    /*
+     * Whether the drone slept at its last step, it is landed and its state
+     * does not change while it sleeps
+     */
+    bool IsDormant() const;
+
     Position getCurrentPosition();
 
     Metric getCurrentMetric(float batteryLevel);
 
-private:
+protected:
+    /*
+     * This function applies the emergency stop and the next command, and
+     * puts an idle drone to sleep. It returns false when the drone sleeps
+     * at this step, otherwise it reads the battery level and updates the
+     * energy model
+     */
+    bool StartStep(Real& batteryLevel);
+
+    /*
+     * This function prints the state of the drone and advances the step
+     * counters
+     */
+    void EndStep(Real batteryLevel);
+
     int m_actionTime;
 
     Action m_currentAction;
 
+    /* Whether the mission starts without a command from the backend */
+    bool m_autoStart;
+
     /* Pointer to the crazyflie distance sensor */
     CCI_CrazyflieDistanceScannerSensor* m_pcDistance;
 
@@ -191,7 +239,41 @@ private:
     /* How close the drone should get to the walls before changing direction */
     float m_distanceThreshold;
 
+    /* Predicts when the drone must return to base */
+    CEnergyModel m_energyModel;
+
+    /* Drones closer than this radius push the drone away */
+    Real m_avoidanceRadius;
+
+    /* Strength of the push, 0 disables the avoidance */
+    Real m_avoidanceGain;
+
+    /* State of the drone at this step, published by the loop functions */
+    Metric m_lastMetric;
+    DistanceReadings m_lastDistances;
+    std::vector<LogData> m_pendingLogs;
+
+    /* Idle drones read their sensors every m_unHeartbeatPeriod steps, 0
+       keeps them awake */
+    UInt32 m_unHeartbeatPeriod;
+
+    /* Steps since the drone fell asleep, 0 while it is awake */
+    UInt32 m_unDormantSteps;
+
+    /* Whether the state was read at this step */
+    bool m_bPublishing;
+
+    /* Slot of the drone, its port is the base port plus the slot */
+    UInt32 m_unSlot;
+
     SimulationServer m_server;
+
+private:
+    /*
+     * This function reads the limits, keepalive and compression of the
+     * server in the <server> node of the parameters
+     */
+    ServerOptions ReadServerOptions(TConfigurationNode& t_node);
 };
 
 #endif
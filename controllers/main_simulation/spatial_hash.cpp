@@ -0,0 +1,106 @@
+#include "spatial_hash.h"
+
+#include <algorithm>
+
+/// @brief Get the grid shared by the loop functions and the controllers
+/// @return Spatial hash instance
+CSpatialHash& CSpatialHash::GetInstance()
+{
+    static CSpatialHash instance;
+    return instance;
+}
+
+/// @brief Constructor of the CSpatialHash
+CSpatialHash::CSpatialHash()
+    : m_cellSize(1.0), m_cellsX(1), m_cellsY(1), m_built(false),
+      m_cellStart(2, 0)
+{
+}
+
+/// @brief Set the area covered by the grid and the size of its cells
+/// @param min Lower corner of the area
+/// @param max Upper corner of the area
+/// @param cellSize Size of the side of a cell, in meters
+void CSpatialHash::Configure(
+    const CVector3& min, const CVector3& max, Real cellSize)
+{
+    m_min = min;
+    m_cellSize = cellSize;
+    m_cellsX = std::max<SInt32>(
+        1,
+        static_cast<SInt32>(std::ceil((max.GetX() - min.GetX()) / cellSize)));
+    m_cellsY = std::max<SInt32>(
+        1,
+        static_cast<SInt32>(std::ceil((max.GetY() - min.GetY()) / cellSize)));
+    m_cellStart.assign(m_cellsX * m_cellsY + 1, 0);
+    m_built = false;
+}
+
+/// @brief Remove every drone, keeping the memory for the next step
+void CSpatialHash::Clear()
+{
+    m_entries.clear();
+    m_built = false;
+}
+
+/// @brief Add a drone to the grid
+/// @param owner Controller of the drone
+/// @param position Position of the drone
+void CSpatialHash::Insert(const void* owner, const CVector3& position)
+{
+    m_entries.push_back({owner, position});
+}
+
+/// @brief Sort the drones by cell with a counting sort
+void CSpatialHash::Build()
+{
+    std::fill(m_cellStart.begin(), m_cellStart.end(), 0);
+    m_cellOfEntry.resize(m_entries.size());
+    m_sorted.resize(m_entries.size());
+
+    for (size_t i = 0; i < m_entries.size(); ++i)
+    {
+        const CVector3& position = m_entries[i].Position;
+        m_cellOfEntry[i] =
+            GetCellY(position.GetY()) * m_cellsX + GetCellX(position.GetX());
+        ++m_cellStart[m_cellOfEntry[i] + 1];
+    }
+
+    for (size_t cell = 1; cell < m_cellStart.size(); ++cell)
+    {
+        m_cellStart[cell] += m_cellStart[cell - 1];
+    }
+
+    // m_cellStart[cell] is used as the insertion index, then shifted back
+    for (size_t i = 0; i < m_entries.size(); ++i)
+    {
+        m_sorted[m_cellStart[m_cellOfEntry[i]]++] = m_entries[i];
+    }
+    for (size_t cell = m_cellStart.size() - 1; cell > 0; --cell)
+    {
+        m_cellStart[cell] = m_cellStart[cell - 1];
+    }
+    m_cellStart[0] = 0;
+
+    m_built = true;
+}
+
+/// @brief Get the column of a position, positions outside are clamped
+/// @param x X coordinate
+/// @return Column of the cell
+SInt32 CSpatialHash::GetCellX(Real x) const
+{
+    SInt32 cell =
+        static_cast<SInt32>(std::floor((x - m_min.GetX()) / m_cellSize));
+    return std::min(std::max(cell, 0), m_cellsX - 1);
+}
+
+/// @brief Get the row of a position, positions outside are clamped
+/// @param y Y coordinate
+/// @return Row of the cell
+SInt32 CSpatialHash::GetCellY(Real y) const
+{
+    SInt32 cell =
+        static_cast<SInt32>(std::floor((y - m_min.GetY()) / m_cellSize));
+    return std::min(std::max(cell, 0), m_cellsY - 1);
+}
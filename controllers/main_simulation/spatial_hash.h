@@ -0,0 +1,110 @@
+/*
+ * Uniform grid of the drone positions, rebuilt once per step by the loop
+ * functions and read by the controllers to find their neighbors.
+ *
+ * The grid covers the arena, so finding the neighbors in a radius only
+ * looks at the few cells around the position, whatever the swarm size.
+ */
+
+#ifndef SPATIAL_HASH_H
+#define SPATIAL_HASH_H
+
+#include <cmath>
+#include <vector>
+
+#include <argos3/core/utility/math/vector3.h>
+
+using namespace argos;
+
+class CSpatialHash
+{
+public:
+    struct SEntry
+    {
+        /* Controller of the drone, used to skip itself in queries */
+        const void* Owner;
+        CVector3 Position;
+    };
+
+    /*
+     * Grid shared by the loop functions and every controller.
+     */
+    static CSpatialHash& GetInstance();
+
+    /*
+     * Sets the area covered by the grid and the size of its cells.
+     */
+    void Configure(const CVector3& min, const CVector3& max, Real cellSize);
+
+    /*
+     * Removes every drone, the memory is kept for the next step.
+     */
+    void Clear();
+
+    void Insert(const void* owner, const CVector3& position);
+
+    /*
+     * Sorts the inserted drones by cell, must be called before the queries.
+     */
+    void Build();
+
+    bool IsBuilt() const { return m_built; }
+
+    /*
+     * Calls function(entry) for every drone closer than radius to position.
+     */
+    template <typename Function>
+    void ForEachNeighbor(
+        const CVector3& position, Real radius, Function function) const
+    {
+        if (!m_built)
+        {
+            return;
+        }
+
+        SInt32 reach = static_cast<SInt32>(std::ceil(radius / m_cellSize));
+        SInt32 cellX = GetCellX(position.GetX());
+        SInt32 cellY = GetCellY(position.GetY());
+        Real radiusSquared = radius * radius;
+
+        for (SInt32 y = std::max(cellY - reach, 0);
+             y <= std::min(cellY + reach, m_cellsY - 1); ++y)
+        {
+            for (SInt32 x = std::max(cellX - reach, 0);
+                 x <= std::min(cellX + reach, m_cellsX - 1); ++x)
+            {
+                UInt32 cell = y * m_cellsX + x;
+                for (UInt32 i = m_cellStart[cell]; i < m_cellStart[cell + 1];
+                     ++i)
+                {
+                    const SEntry& entry = m_sorted[i];
+                    if ((entry.Position - position).SquareLength() <=
+                        radiusSquared)
+                    {
+                        function(entry);
+                    }
+                }
+            }
+        }
+    }
+
+private:
+    CSpatialHash();
+
+    SInt32 GetCellX(Real x) const;
+    SInt32 GetCellY(Real y) const;
+
+    CVector3 m_min;
+    Real m_cellSize;
+    SInt32 m_cellsX;
+    SInt32 m_cellsY;
+    bool m_built;
+
+    std::vector<SEntry> m_entries;
+    std::vector<SEntry> m_sorted;
+    std::vector<UInt32> m_cellOfEntry;
+    /* Index in m_sorted of the first drone of each cell */
+    std::vector<UInt32> m_cellStart;
+};
+
+#endif
@@ -3,7 +3,7 @@
 shopt -s globstar
 
 style=file
-regex="controllers/**/*.cpp communication/**/*.cpp controllers/**/*.h communication/**/*.h"
+regex="controllers/**/*.cpp communication/**/*.cpp controllers/**/*.h communication/**/*.h loop_functions/**/*.cpp loop_functions/**/*.h gateway/**/*.cpp gateway/**/*.h benchmark/**/*.cpp"
 
 echo $regex
 
@@ -0,0 +1,581 @@
+#include "gateway_service.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <thread>
+
+/// @brief Constructor of the GatewayService
+/// @param shards Address of the control server of each shard (host:port)
+/// @param port Port of the gateway, returned to the clients by ListDrones
+GatewayService::GatewayService(
+    std::vector<std::string> shards, unsigned int port)
+    : m_shards(shards), m_port(port)
+{
+}
+
+/// @brief Forward the start mission command to the shard of the drone
+/// @param context Server context
+/// @param request Request from the server
+/// @param reply Reply to the server
+/// @return Status of the request
+Status GatewayService::StartMission(
+    ServerContext* context, const MissionRequest* request, MissionReply* reply)
+{
+    return Forward(
+        request->uri(), reply,
+        [&](Simulation::Stub& stub, grpc::ClientContext* client)
+        { return stub.StartMission(client, *request, reply); });
+}
+
+/// @brief Forward the end mission command to the shard of the drone
+/// @param context Server context
+/// @param request Request from the server
+/// @param reply Reply to the server
+/// @return Status of the request
+Status GatewayService::EndMission(
+    ServerContext* context, const MissionRequest* request, MissionReply* reply)
+{
+    return Forward(
+        request->uri(), reply,
+        [&](Simulation::Stub& stub, grpc::ClientContext* client)
+        { return stub.EndMission(client, *request, reply); });
+}
+
+/// @brief Forward the return command to the shard of the drone
+/// @param context Server context
+/// @param request Request from the server
+/// @param reply Reply to the server
+/// @return Status of the request
+Status GatewayService::ReturnToBase(
+    ServerContext* context, const MissionRequest* request, MissionReply* reply)
+{
+    return Forward(
+        request->uri(), reply,
+        [&](Simulation::Stub& stub, grpc::ClientContext* client)
+        { return stub.ReturnToBase(client, *request, reply); });
+}
+
+/// @brief Forward the emergency stop to the shard of the drone
+/// @param context Server context
+/// @param request Request from the server
+/// @param reply Reply to the server
+/// @return Status of the request
+Status GatewayService::EmergencyStop(
+    ServerContext* context, const MissionRequest* request, MissionReply* reply)
+{
+    return Forward(
+        request->uri(), reply,
+        [&](Simulation::Stub& stub, grpc::ClientContext* client)
+        { return stub.EmergencyStop(client, *request, reply); });
+}
+
+/// @brief Forward the telemetrics request to the shard of the drone
+/// @param context Server context
+/// @param request Request from the server
+/// @param reply Reply to the server
+/// @return Status of the request
+Status GatewayService::GetTelemetrics(
+    ServerContext* context, const HistoryRequest* request,
+    TelemetricsReply* reply)
+{
+    return Forward(
+        request->uri(), reply,
+        [&](Simulation::Stub& stub, grpc::ClientContext* client)
+        { return stub.GetTelemetrics(client, *request, reply); });
+}
+
+/// @brief Forward the distances request to the shard of the drone
+/// @param context Server context
+/// @param request Request from the server
+/// @param reply Reply to the server
+/// @return Status of the request
+Status GatewayService::GetDistances(
+    ServerContext* context, const HistoryRequest* request,
+    DistancesReply* reply)
+{
+    return Forward(
+        request->uri(), reply,
+        [&](Simulation::Stub& stub, grpc::ClientContext* client)
+        { return stub.GetDistances(client, *request, reply); });
+}
+
+/// @brief Forward the logs request to the shard of the drone
+/// @param context Server context
+/// @param request Request from the server
+/// @param reply Reply to the server
+/// @return Status of the request
+Status GatewayService::GetLogs(
+    ServerContext* context, const HistoryRequest* request, LogReply* reply)
+{
+    return Forward(
+        request->uri(), reply,
+        [&](Simulation::Stub& stub, grpc::ClientContext* client)
+        { return stub.GetLogs(client, *request, reply); });
+}
+
+/// @brief List the drones of every shard, all reachable through the gateway
+/// @param context Server context
+/// @param request Request from the server
+/// @param reply Reply to the server
+/// @return Status of the request
+Status GatewayService::ListDrones(
+    ServerContext* context, const DronesRequest* request, DronesReply* reply)
+{
+    Refresh();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    unsigned int slot = 0;
+    for (const auto& drone : m_drones)
+    {
+        simulation::Drone* rpc_drone = reply->add_drones();
+        rpc_drone->set_uri(drone.first);
+        rpc_drone->set_slot(slot++);
+        rpc_drone->set_port(m_port);
+    }
+
+    return Status::OK;
+}
+
+/// @brief Split the group command by shard and merge the replies
+/// @param context Server context
+/// @param request Request from the server
+/// @param writer Stream of replies to the server
+/// @return Status of the request
+Status GatewayService::GroupCommand(
+    ServerContext* context, const GroupRequest* request,
+    ServerWriter<GroupReply>* writer)
+{
+    std::vector<GroupRequest> requests(m_shards.size());
+    for (GroupRequest& shardRequest : requests)
+    {
+        shardRequest.set_action(request->action());
+    }
+
+    for (const std::string& uri : request->uris())
+    {
+        if (uri == "all")
+        {
+            for (GroupRequest& shardRequest : requests)
+            {
+                shardRequest.clear_uris();
+                shardRequest.add_uris("all");
+            }
+            break;
+        }
+
+        DroneRoute route;
+        if (!FindDrone(uri, &route))
+        {
+            GroupReply reply;
+            reply.set_uri(uri);
+            reply.set_message("Unknown drone");
+            writer->Write(reply);
+            continue;
+        }
+        requests[route.shard].add_uris(uri);
+    }
+
+    std::mutex writerMutex;
+    std::atomic<size_t> finished(0);
+    std::vector<std::thread> threads;
+    std::vector<std::unique_ptr<grpc::ClientContext>> clients;
+    for (size_t shard = 0; shard < m_shards.size(); ++shard)
+    {
+        if (requests[shard].uris_size() == 0)
+        {
+            continue;
+        }
+
+        clients.push_back(std::make_unique<grpc::ClientContext>());
+        grpc::ClientContext* client = clients.back().get();
+        std::shared_ptr<Simulation::Stub> stub = GetStub(m_shards[shard]);
+        const GroupRequest& shardRequest = requests[shard];
+
+        threads.emplace_back(
+            [&, client, stub]
+            {
+                auto reader = stub->GroupCommand(client, shardRequest);
+                GroupReply reply;
+                while (reader->Read(&reply))
+                {
+                    std::lock_guard<std::mutex> lock(writerMutex);
+                    writer->Write(reply);
+                }
+                reader->Finish();
+                ++finished;
+            });
+    }
+
+    // The shards are cancelled as soon as the client goes away
+    const std::chrono::milliseconds WAIT_INTERVAL(100);
+    bool cancelled = false;
+    while (finished < threads.size())
+    {
+        if (context->IsCancelled())
+        {
+            cancelled = true;
+            for (auto& client : clients)
+            {
+                client->TryCancel();
+            }
+            break;
+        }
+        std::this_thread::sleep_for(WAIT_INTERVAL);
+    }
+
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+
+    return cancelled ? Status::CANCELLED : Status::OK;
+}
+
+/// @brief Subscribe to one or every drone and merge the streams. Every
+/// drone is followed with one stream per shard, whose updates already hold
+/// the uri of their drone.
+/// @param context Server context
+/// @param request Request from the server
+/// @param writer Stream of updates to the server
+/// @return Status of the request
+Status GatewayService::Subscribe(
+    ServerContext* context, const SubscriptionRequest* request,
+    ServerWriter<SubscriptionUpdate>* writer)
+{
+    SubscriptionRequest shardRequest = *request;
+    std::vector<std::shared_ptr<Simulation::Stub>> stubs;
+    if (request->uri().empty() || request->uri() == "all")
+    {
+        shardRequest.set_uri("all");
+        for (const std::string& shard : m_shards)
+        {
+            stubs.push_back(GetStub(shard));
+        }
+    }
+    else
+    {
+        DroneRoute route;
+        if (!FindDrone(request->uri(), &route))
+        {
+            return Status(
+                grpc::StatusCode::NOT_FOUND, "Unknown drone " + request->uri());
+        }
+        stubs.push_back(route.stub);
+    }
+
+    std::mutex writerMutex;
+    bool connected = true;
+    std::vector<std::thread> threads;
+    std::vector<std::unique_ptr<grpc::ClientContext>> clients;
+    for (const std::shared_ptr<Simulation::Stub>& stub : stubs)
+    {
+        clients.push_back(std::make_unique<grpc::ClientContext>());
+        grpc::ClientContext* client = clients.back().get();
+
+        threads.emplace_back(
+            [&, client, stub]
+            {
+                auto reader = stub->Subscribe(client, shardRequest);
+                SubscriptionUpdate update;
+                while (reader->Read(&update))
+                {
+                    if (update.uri().empty())
+                    {
+                        update.set_uri(request->uri());
+                    }
+
+                    std::lock_guard<std::mutex> lock(writerMutex);
+                    if (connected && !writer->Write(update))
+                    {
+                        connected = false;
+                    }
+                }
+                reader->Finish();
+            });
+    }
+
+    const std::chrono::milliseconds WAIT_INTERVAL(1000);
+    while (!context->IsCancelled())
+    {
+        {
+            std::lock_guard<std::mutex> lock(writerMutex);
+            if (!connected)
+            {
+                break;
+            }
+        }
+        std::this_thread::sleep_for(WAIT_INTERVAL);
+    }
+
+    for (auto& client : clients)
+    {
+        client->TryCancel();
+    }
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+
+    return Status::OK;
+}
+
+/// @brief Merge the exploration metrics of every shard. The regions of the
+/// shards do not overlap, so the covered areas add up. The shards sample the
+/// same ticks, so a cursor names the same sample in every shard and the
+/// history only holds the samples every shard already has.
+/// @param context Server context
+/// @param request Request from the server
+/// @param reply Reply to the server
+/// @return Status of the request
+Status GatewayService::GetCoverage(
+    ServerContext* context, const CoverageRequest* request,
+    CoverageReply* reply)
+{
+    float sharedArea = 0;
+    std::map<unsigned int, std::pair<float, size_t>> history;
+    uint64_t nextCursor = UINT64_MAX;
+
+    for (const std::string& shard : m_shards)
+    {
+        CoverageReply shardReply;
+        grpc::ClientContext client;
+        Status status =
+            GetStub(shard)->GetCoverage(&client, *request, &shardReply);
+        if (!status.ok())
+        {
+            return status;
+        }
+
+        reply->set_tick(std::max(reply->tick(), shardReply.tick()));
+        reply->set_covered_area(
+            reply->covered_area() + shardReply.covered_area());
+        reply->set_coverage_ratio(
+            reply->coverage_ratio() + shardReply.coverage_ratio());
+        sharedArea += shardReply.overlap_ratio() * shardReply.covered_area();
+
+        for (const simulation::DroneCoverage& drone : shardReply.drones())
+        {
+            *reply->add_drones() = drone;
+        }
+        for (const simulation::CoveragePoint& point : shardReply.history())
+        {
+            std::pair<float, size_t>& merged = history[point.tick()];
+            merged.first += point.covered_area();
+            ++merged.second;
+        }
+
+        nextCursor = std::min<uint64_t>(nextCursor, shardReply.next_cursor());
+        reply->set_first_cursor(
+            std::max(reply->first_cursor(), shardReply.first_cursor()));
+    }
+
+    if (reply->covered_area() > 0)
+    {
+        reply->set_overlap_ratio(sharedArea / reply->covered_area());
+    }
+
+    if (!request->history())
+    {
+        return Status::OK;
+    }
+
+    // The samples missing from a shard are sent by the next request, which
+    // starts at the cursor of the slowest shard
+    for (const auto& point : history)
+    {
+        if (point.second.second != m_shards.size())
+        {
+            continue;
+        }
+
+        simulation::CoveragePoint* rpc_point = reply->add_history();
+        rpc_point->set_tick(point.first);
+        rpc_point->set_covered_area(point.second.first);
+    }
+    reply->set_next_cursor(m_shards.empty() ? 0 : nextCursor);
+
+    return Status::OK;
+}
+
+/// @brief Merge the last frame of every shard. The shards are not stepped
+/// together, so the tick of the reply is the oldest of the shards.
+/// @param context Server context
+/// @param request Request from the server
+/// @param reply Reply to the server
+/// @return Status of the request
+Status GatewayService::GetSwarmFrame(
+    ServerContext* context, const FrameRequest* request, FrameReply* reply)
+{
+    bool first = true;
+    for (const std::string& shard : m_shards)
+    {
+        FrameReply shardReply;
+        grpc::ClientContext client;
+        Status status =
+            GetStub(shard)->GetSwarmFrame(&client, *request, &shardReply);
+        if (!status.ok())
+        {
+            return status;
+        }
+
+        reply->set_tick(
+            first ? shardReply.tick()
+                  : std::min(reply->tick(), shardReply.tick()));
+        first = false;
+
+        for (simulation::DroneState& drone : *shardReply.mutable_drones())
+        {
+            reply->add_drones()->Swap(&drone);
+        }
+    }
+
+    return Status::OK;
+}
+
+/// @brief Merge the tick timings of every shard. The shards run side by
+/// side, so the reply follows the slowest of them: the overruns are the
+/// most of a shard, counted over the same ticks as the others.
+/// @param context Server context
+/// @param request Request from the server
+/// @param reply Reply to the server
+/// @return Status of the request
+Status GatewayService::GetPacing(
+    ServerContext* context, const PacingRequest* request, PacingReply* reply)
+{
+    bool first = true;
+    for (const std::string& shard : m_shards)
+    {
+        PacingReply shardReply;
+        grpc::ClientContext client;
+        Status status =
+            GetStub(shard)->GetPacing(&client, *request, &shardReply);
+        if (!status.ok())
+        {
+            return status;
+        }
+
+        if (first)
+        {
+            *reply = shardReply;
+            first = false;
+            continue;
+        }
+
+        reply->set_tick(std::min(reply->tick(), shardReply.tick()));
+        reply->set_ticks(std::min(reply->ticks(), shardReply.ticks()));
+        reply->set_overruns(std::max(reply->overruns(), shardReply.overruns()));
+        reply->set_achieved_factor(
+            std::min(reply->achieved_factor(), shardReply.achieved_factor()));
+        reply->set_last_tick_us(
+            std::max(reply->last_tick_us(), shardReply.last_tick_us()));
+        reply->set_mean_tick_us(
+            std::max(reply->mean_tick_us(), shardReply.mean_tick_us()));
+        reply->set_max_tick_us(
+            std::max(reply->max_tick_us(), shardReply.max_tick_us()));
+    }
+
+    return Status::OK;
+}
+
+/// @brief Ask every shard for its drones and remember where they run
+void GatewayService::Refresh()
+{
+    std::map<std::string, DroneRoute> drones;
+
+    for (size_t shard = 0; shard < m_shards.size(); ++shard)
+    {
+        DronesReply reply;
+        grpc::ClientContext client;
+        if (!GetStub(m_shards[shard])
+                 ->ListDrones(&client, DronesRequest(), &reply)
+                 .ok())
+        {
+            std::cerr << "Shard " << m_shards[shard] << " is not reachable"
+                      << std::endl;
+            continue;
+        }
+
+        const std::string& address = m_shards[shard];
+        std::string host = address.substr(0, address.rfind(':'));
+        for (const simulation::Drone& drone : reply.drones())
+        {
+            drones[drone.uri()] = DroneRoute{
+                shard, GetStub(host + ":" + std::to_string(drone.port()))};
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_drones = drones;
+}
+
+/// @brief Find the shard running a drone, the shards are asked again if the
+/// drone is unknown
+/// @param uri Uri of the drone
+/// @param route Filled with the shard and the server of the drone
+/// @return True if the drone was found, False if not
+bool GatewayService::FindDrone(const std::string& uri, DroneRoute* route)
+{
+    for (int attempt = 0; attempt < 2; ++attempt)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto drone = m_drones.find(uri);
+            if (drone != m_drones.end())
+            {
+                *route = drone->second;
+                return true;
+            }
+        }
+
+        if (attempt == 0)
+        {
+            Refresh();
+        }
+    }
+
+    return false;
+}
+
+/// @brief Get the stub of a server, the channels are reused
+/// @param address Address of the server (host:port)
+/// @return Stub of the server
+std::shared_ptr<Simulation::Stub>
+GatewayService::GetStub(const std::string& address)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto stub = m_stubs.find(address);
+    if (stub != m_stubs.end())
+    {
+        return stub->second;
+    }
+
+    std::shared_ptr<Simulation::Stub> newStub = Simulation::NewStub(
+        grpc::CreateChannel(address, grpc::InsecureChannelCredentials()));
+    m_stubs[address] = newStub;
+
+    return newStub;
+}
+
+/// @brief Send a request to the server of a drone
+/// @param uri Uri of the drone
+/// @param reply Reply to the server
+/// @param call Function sending the request with the stub of the drone
+/// @return Status of the request
+template <typename Reply, typename Call>
+Status GatewayService::Forward(const std::string& uri, Reply* reply, Call call)
+{
+    DroneRoute route;
+    if (!FindDrone(uri, &route))
+    {
+        return Status(grpc::StatusCode::NOT_FOUND, "Unknown drone " + uri);
+    }
+
+    grpc::ClientContext client;
+    return call(*route.stub, &client);
+}
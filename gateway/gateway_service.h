@@ -0,0 +1,104 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <grpcpp/grpcpp.h>
+
+#include "simulation.grpc.pb.h"
+
+using simulation::CoverageReply;
+using simulation::CoverageRequest;
+using simulation::DistancesReply;
+using simulation::DronesReply;
+using simulation::DronesRequest;
+using simulation::FrameReply;
+using simulation::FrameRequest;
+using simulation::GroupReply;
+using simulation::GroupRequest;
+using simulation::HistoryRequest;
+using simulation::LogReply;
+using simulation::MissionReply;
+using simulation::MissionRequest;
+using simulation::PacingReply;
+using simulation::PacingRequest;
+using simulation::Simulation;
+using simulation::SubscriptionRequest;
+using simulation::SubscriptionUpdate;
+using simulation::TelemetricsReply;
+
+using grpc::ServerContext;
+using grpc::ServerWriter;
+using grpc::Status;
+
+/// Single endpoint in front of the simulation shards. Requests are sent to
+/// the shard running the drone and the streams of the shards are merged.
+class GatewayService final : public Simulation::Service
+{
+public:
+    GatewayService(std::vector<std::string> shards, unsigned int port);
+
+    Status StartMission(
+        ServerContext* context, const MissionRequest* request,
+        MissionReply* reply) override;
+    Status EndMission(
+        ServerContext* context, const MissionRequest* request,
+        MissionReply* reply) override;
+    Status ReturnToBase(
+        ServerContext* context, const MissionRequest* request,
+        MissionReply* reply) override;
+    Status EmergencyStop(
+        ServerContext* context, const MissionRequest* request,
+        MissionReply* reply) override;
+    Status GetTelemetrics(
+        ServerContext* context, const HistoryRequest* request,
+        TelemetricsReply* reply) override;
+    Status GetDistances(
+        ServerContext* context, const HistoryRequest* request,
+        DistancesReply* reply) override;
+    Status GetLogs(
+        ServerContext* context, const HistoryRequest* request,
+        LogReply* reply) override;
+    Status ListDrones(
+        ServerContext* context, const DronesRequest* request,
+        DronesReply* reply) override;
+    Status GroupCommand(
+        ServerContext* context, const GroupRequest* request,
+        ServerWriter<GroupReply>* writer) override;
+    Status Subscribe(
+        ServerContext* context, const SubscriptionRequest* request,
+        ServerWriter<SubscriptionUpdate>* writer) override;
+    Status GetCoverage(
+        ServerContext* context, const CoverageRequest* request,
+        CoverageReply* reply) override;
+    Status GetSwarmFrame(
+        ServerContext* context, const FrameRequest* request,
+        FrameReply* reply) override;
+    Status GetPacing(
+        ServerContext* context, const PacingRequest* request,
+        PacingReply* reply) override;
+
+private:
+    struct DroneRoute
+    {
+        size_t shard;
+        std::shared_ptr<Simulation::Stub> stub;
+    };
+
+    void Refresh();
+    bool FindDrone(const std::string& uri, DroneRoute* route);
+    std::shared_ptr<Simulation::Stub> GetStub(const std::string& address);
+
+    template <typename Reply, typename Call>
+    Status Forward(const std::string& uri, Reply* reply, Call call);
+
+    std::vector<std::string> m_shards;
+    unsigned int m_port;
+
+    std::mutex m_mutex;
+    std::map<std::string, std::shared_ptr<Simulation::Stub>> m_stubs;
+    std::map<std::string, DroneRoute> m_drones;
+};
@@ -0,0 +1,43 @@
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <grpcpp/grpcpp.h>
+
+#include "gateway_service.h"
+
+/// @brief Run the gateway in front of the simulation shards
+/// Usage: simulation_gateway <port> <shard control host:port>...
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        std::cerr << "Usage: " << argv[0]
+                  << " <port> <shard control host:port>..." << std::endl;
+        return 1;
+    }
+
+    unsigned int port = std::stoul(argv[1]);
+    std::vector<std::string> shards(argv + 2, argv + argc);
+
+    GatewayService service(shards, port);
+
+    std::string address = "0.0.0.0:" + std::to_string(port);
+    grpc::ServerBuilder builder;
+    builder.AddListeningPort(address, grpc::InsecureServerCredentials());
+    builder.RegisterService(&service);
+
+    std::unique_ptr<grpc::Server> server(builder.BuildAndStart());
+    if (!server)
+    {
+        std::cerr << "Gateway could not listen on " << address << std::endl;
+        return 1;
+    }
+
+    std::cout << "Gateway listening on " << address << " for "
+              << shards.size() << " shards" << std::endl;
+    server->Wait();
+
+    return 0;
+}
@@ -0,0 +1,137 @@
+#!/bin/bash
+
+# Replay the simulation headless for a fixed set of seeds and compare the
+# trajectories and outcomes to the golden files in experiments/golden.
+# The tick times of every run are appended to golden_run_results.csv so
+# performance regressions can be bisected on the same workloads.
+
+config=experiments/golden_run.argos
+golden_dir=experiments/golden
+output_dir=golden_output
+results=golden_run_results.csv
+tolerance=0.001
+
+while [[ $# -gt 0 ]]; do
+  case $1 in
+    -r|--record)
+      record=true
+      shift
+      ;;
+    -s|--seeds)
+      seeds="$2"
+      shift
+      shift
+      ;;
+    -*|--*)
+      echo "Unknown option $1"
+      exit 1
+      ;;
+    *)
+      echo "Unknown argument $1"
+      exit 1
+      ;;
+  esac
+done
+
+if [ -z "$seeds" ]
+then
+    seeds=$(cat $golden_dir/seeds.txt)
+fi
+
+mkdir -p $output_dir
+if [ ! -f $results ]
+then
+    echo "commit,seed,ticks,mean_us,p99_us,max_us" > $results
+fi
+
+commit=$(git rev-parse --short HEAD 2>/dev/null || echo "unknown")
+failed=0
+
+# The references are taken from a commit, so that a later run tells which
+# behavior they hold
+if [ $record ]
+then
+    if [ -n "$(git status --porcelain --untracked-files=no 2>/dev/null)" ]
+    then
+        echo "Commit the changes before recording the golden files"
+        exit 1
+    fi
+    echo $commit > $golden_dir/recorded_at
+elif [ -f $golden_dir/recorded_at ]
+then
+    echo "Golden files recorded at $(cat $golden_dir/recorded_at)"
+fi
+
+for seed in $seeds
+do
+    prefix=$output_dir/seed_$seed
+    run_config=$output_dir/seed_$seed.argos
+
+    sed -E -e "s/random_seed=\"[^\"]*\"/random_seed=\"$seed\"/" \
+        -e "s|output=\"[^\"]*\"|output=\"$prefix\"|" $config > $run_config
+
+    echo "==== Seed $seed ===="
+    if ! argos3 -c $run_config > $prefix.log 2>&1
+    then
+        echo "argos3 failed, see $prefix.log"
+        failed=1
+        continue
+    fi
+
+    tail -n +2 $prefix"_timing.csv" | sort -t, -k2 -g | awk -F, -v commit=$commit -v seed=$seed '
+        { times[n++] = $2; total += $2 }
+        END {
+            if (n == 0) { exit }
+            printf "%s,%s,%d,%.1f,%.1f,%.1f\n", commit, seed, n, total / n,
+                times[int(n * 0.99)], times[n - 1]
+        }' | tee -a $results
+
+    if [ $record ]
+    then
+        cp $prefix"_trajectory.csv" $golden_dir/seed_$seed"_trajectory.csv"
+        cp $prefix"_outcome.csv" $golden_dir/seed_$seed"_outcome.csv"
+        echo "Recorded golden files"
+        continue
+    fi
+
+    # A missing reference is a failure, the run would compare to nothing
+    golden_files="$golden_dir/seed_$seed"_outcome.csv" $golden_dir/seed_$seed"_trajectory.csv""
+    missing=0
+    for file in $golden_files
+    do
+        if [ ! -f $file ]
+        then
+            echo "No golden file $file, run ./golden_run.sh --record"
+            missing=1
+        fi
+    done
+    if [ $missing -ne 0 ]
+    then
+        failed=1
+        continue
+    fi
+
+    if ! diff -q $golden_dir/seed_$seed"_outcome.csv" $prefix"_outcome.csv" > /dev/null
+    then
+        echo "Outcome differs from golden run"
+        failed=1
+    fi
+
+    if ! paste -d, $golden_dir/seed_$seed"_trajectory.csv" $prefix"_trajectory.csv" | awk -F, -v tol=$tolerance '
+        function abs(v) { return v < 0 ? -v : v }
+        NR == 1 { next }
+        $1 != $7 || $2 != $8 || $3 != $9 ||
+        abs($4 - $10) > tol || abs($5 - $11) > tol || abs($6 - $12) > tol {
+            print "Trajectory differs at tick " $1 " for " $2
+            exit 1
+        }'
+    then
+        failed=1
+    elif [ $(wc -l < $golden_dir/seed_$seed"_trajectory.csv") -ne $(wc -l < $prefix"_trajectory.csv") ]
+    then
+        echo "Trajectory length differs from golden run"
+        failed=1
+    fi
+done
+
+exit $failed
@@ -0,0 +1,158 @@
+#include "golden_run_loop_functions.h"
+
+#include <algorithm>
+#include <iomanip>
+
+#include <argos3/core/utility/configuration/argos_configuration.h>
+#include <argos3/core/utility/logging/argos_log.h>
+#include <argos3/plugins/robots/crazyflie/simulator/crazyflie_entity.h>
+
+#include <main_simulation/main_simulation.h>
+
+/****************************************/
+/****************************************/
+
+/// @brief Get the controller of a crazyflie entity
+/// @param entity Crazyflie entity
+/// @return Controller of the drone
+static CMainSimulation& getController(CCrazyflieEntity& entity)
+{
+    return dynamic_cast<CMainSimulation&>(
+        entity.GetControllableEntity().GetController());
+}
+
+/// @brief Constructor of the CGoldenRunLoopFunctions
+CGoldenRunLoopFunctions::CGoldenRunLoopFunctions()
+    : m_strOutput("golden_run"), m_unSamplingPeriod(1)
+{
+}
+
+/// @brief Read the parameters and open the output files
+/// @param t_tree <loop_functions> section of the XML file
+void CGoldenRunLoopFunctions::Init(TConfigurationNode& t_tree)
+{
+    CMainLoopFunctions::Init(t_tree);
+
+    GetNodeAttributeOrDefault(t_tree, "output", m_strOutput, m_strOutput);
+    GetNodeAttributeOrDefault(
+        t_tree, "sampling_period", m_unSamplingPeriod, m_unSamplingPeriod);
+
+    if (m_unSamplingPeriod == 0)
+    {
+        THROW_ARGOSEXCEPTION("sampling_period must be greater than 0");
+    }
+
+    OpenFiles();
+}
+
+/// @brief Clear the recorded timings and restart the output files
+void CGoldenRunLoopFunctions::Reset()
+{
+    CMainLoopFunctions::Reset();
+    m_cTrajectoryFile.close();
+    m_cTimingFile.close();
+    m_vecTickTimes.clear();
+    OpenFiles();
+}
+
+/// @brief Start timing the tick
+void CGoldenRunLoopFunctions::PreStep()
+{
+    m_tTickStart = std::chrono::steady_clock::now();
+    CMainLoopFunctions::PreStep();
+}
+
+/// @brief Stop timing the tick and record the state of the drones
+void CGoldenRunLoopFunctions::PostStep()
+{
+    CMainLoopFunctions::PostStep();
+
+    Real tickTime = std::chrono::duration<Real, std::micro>(
+                        std::chrono::steady_clock::now() - m_tTickStart)
+                        .count();
+    m_vecTickTimes.push_back(tickTime);
+
+    UInt32 tick = GetSpace().GetSimulationClock();
+    m_cTimingFile << tick << "," << tickTime << "," << GetTickAllocations()
+                  << "\n";
+
+    if (tick % m_unSamplingPeriod != 0)
+    {
+        return;
+    }
+
+    CSpace::TMapPerType& drones = GetSpace().GetEntitiesByType("crazyflie");
+    for (auto& [id, entity] : drones)
+    {
+        CCrazyflieEntity& drone = *any_cast<CCrazyflieEntity*>(entity);
+        const CVector3& position =
+            drone.GetEmbodiedEntity().GetOriginAnchor().Position;
+
+        m_cTrajectoryFile
+            << tick << "," << id << ","
+            << static_cast<int>(getController(drone).GetCurrentAction()) << ","
+            << position.GetX() << "," << position.GetY() << ","
+            << position.GetZ() << "\n";
+    }
+}
+
+/// @brief Write the outcome of the run and the timing summary
+void CGoldenRunLoopFunctions::Destroy()
+{
+    CMainLoopFunctions::Destroy();
+
+    std::ofstream outcomeFile(m_strOutput + "_outcome.csv");
+    outcomeFile << "id,action" << std::endl;
+
+    CSpace::TMapPerType& drones = GetSpace().GetEntitiesByType("crazyflie");
+    for (auto& [id, entity] : drones)
+    {
+        CCrazyflieEntity& drone = *any_cast<CCrazyflieEntity*>(entity);
+        outcomeFile << id << ","
+                    << static_cast<int>(getController(drone).GetCurrentAction())
+                    << std::endl;
+    }
+
+    if (!m_vecTickTimes.empty())
+    {
+        std::vector<Real> sorted = m_vecTickTimes;
+        std::sort(sorted.begin(), sorted.end());
+
+        Real total = 0;
+        for (Real time : sorted)
+        {
+            total += time;
+        }
+
+        LOG << "Ticks: " << sorted.size() << std::endl;
+        LOG << "Tick time mean (us): " << total / sorted.size() << std::endl;
+        LOG << "Tick time p50 (us): " << sorted[sorted.size() / 2]
+            << std::endl;
+        LOG << "Tick time p99 (us): " << sorted[sorted.size() * 99 / 100]
+            << std::endl;
+        LOG << "Tick time max (us): " << sorted.back() << std::endl;
+    }
+
+    m_cTrajectoryFile.close();
+    m_cTimingFile.close();
+}
+
+/// @brief Open the trajectory and timing files and write their headers
+void CGoldenRunLoopFunctions::OpenFiles()
+{
+    m_cTrajectoryFile.open(m_strOutput + "_trajectory.csv", std::ios::trunc);
+    m_cTimingFile.open(m_strOutput + "_timing.csv", std::ios::trunc);
+
+    if (!m_cTrajectoryFile || !m_cTimingFile)
+    {
+        THROW_ARGOSEXCEPTION(
+            "Could not open the output files \"" << m_strOutput << "_*.csv\"");
+    }
+
+    m_cTrajectoryFile << std::fixed << std::setprecision(4);
+    m_cTrajectoryFile << "tick,id,action,x,y,z\n";
+    m_cTimingFile << std::fixed << std::setprecision(1);
+    m_cTimingFile << "tick,time_us,allocations\n";
+}
+
+REGISTER_LOOP_FUNCTIONS(CGoldenRunLoopFunctions, "golden_run_loop_functions")
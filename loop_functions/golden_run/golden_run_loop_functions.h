@@ -0,0 +1,75 @@
+/*
+ * Loop functions used to replay the simulation headless with a fixed seed.
+ *
+ * They extend the loop functions of the main simulation. Every tick, the
+ * position and current action of each drone is written to a trajectory file
+ * and the wall time and heap allocations of the tick are written to a timing
+ * file. The outcome of the run (last action of each drone) is written when
+ * the experiment ends. The files are compared to golden files by
+ * golden_run.sh.
+ *
+ * This loop function is meant to be used with the XML file:
+ *    experiments/golden_run.argos
+ */
+
+#ifndef GOLDEN_RUN_LOOP_FUNCTIONS_H
+#define GOLDEN_RUN_LOOP_FUNCTIONS_H
+
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <main_simulation/main_loop_functions.h>
+
+class CGoldenRunLoopFunctions : public CMainLoopFunctions
+{
+public:
+    CGoldenRunLoopFunctions();
+    virtual ~CGoldenRunLoopFunctions() {}
+
+    /*
+     * Opens the output files given in the <loop_functions> section.
+     */
+    virtual void Init(TConfigurationNode& t_tree);
+
+    /*
+     * Clears the recorded timings and truncates the output files.
+     */
+    virtual void Reset();
+
+    /*
+     * Starts the tick timer, before the controllers are stepped.
+     */
+    virtual void PreStep();
+
+    /*
+     * Stops the tick timer and records the state of every drone.
+     */
+    virtual void PostStep();
+
+    /*
+     * Writes the outcome and the timing summary, then closes the files.
+     */
+    virtual void Destroy();
+
+private:
+    void OpenFiles();
+
+    /* Prefix of the output files */
+    std::string m_strOutput;
+
+    /* A trajectory sample is written every m_unSamplingPeriod ticks */
+    UInt32 m_unSamplingPeriod;
+
+    std::ofstream m_cTrajectoryFile;
+    std::ofstream m_cTimingFile;
+
+    /* Wall time at the start of the current tick */
+    std::chrono::steady_clock::time_point m_tTickStart;
+
+    /* Wall time of every tick, in microseconds */
+    std::vector<Real> m_vecTickTimes;
+};
+
+#endif
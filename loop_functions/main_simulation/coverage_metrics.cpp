@@ -0,0 +1,274 @@
+#include "coverage_metrics.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <fstream>
+
+/* Reports kept for reuse, readers holding more reports get new ones */
+static const size_t MAX_POOLED_REPORTS = 4;
+
+/* Reading of the crazyflie distance scanner when no obstacle is in its
+ * range, it reads -1 when an obstacle is closer than its minimum range */
+static const Real NOTHING_IN_RANGE = -2.0;
+
+/* Defined here too, the markers are bound to references by assign() */
+const SInt32 CCoverageMetrics::UNSEEN;
+const SInt32 CCoverageMetrics::SHARED;
+
+/// @brief Constructor of the CCoverageMetrics
+CCoverageMetrics::CCoverageMetrics()
+    : m_cellSize(0.1), m_sensorRange(1.5), m_cellsX(0), m_cellsY(0),
+      m_coveredCells(0), m_sharedCells(0)
+{
+}
+
+/// @brief Set the area covered and the size of the cells
+/// @param min Lower corner of the area
+/// @param max Upper corner of the area
+/// @param cellSize Size of the side of a cell, in meters
+/// @param sensorRange Length of the rays that do not hit anything, in meters
+void CCoverageMetrics::Configure(
+    const CVector3& min, const CVector3& max, Real cellSize, Real sensorRange)
+{
+    m_min = min;
+    m_cellSize = cellSize;
+    m_sensorRange = sensorRange;
+    m_cellsX = std::max<SInt32>(
+        1,
+        static_cast<SInt32>(std::ceil((max.GetX() - min.GetX()) / cellSize)));
+    m_cellsY = std::max<SInt32>(
+        1,
+        static_cast<SInt32>(std::ceil((max.GetY() - min.GetY()) / cellSize)));
+    Reset();
+}
+
+/// @brief Forget the drones and every seen cell
+void CCoverageMetrics::Reset()
+{
+    m_cells.assign(m_cellsX * m_cellsY, UNSEEN);
+    m_coveredCells = 0;
+    m_sharedCells = 0;
+    m_droneIndex.clear();
+    m_droneIds.clear();
+    m_droneDistance.clear();
+    m_droneDiscovered.clear();
+    m_dronePosition.clear();
+    m_droneHasPosition.clear();
+    m_history.clear();
+}
+
+/// @brief Get the index of a drone, adding it if it is new
+/// @param id Entity id of the drone
+/// @return Index of the drone
+UInt32 CCoverageMetrics::GetDroneIndex(const std::string& id)
+{
+    auto drone = m_droneIndex.find(id);
+    if (drone != m_droneIndex.end())
+    {
+        return drone->second;
+    }
+
+    m_droneIndex[id] = m_droneIds.size();
+    m_droneIds.push_back(id);
+    m_droneDistance.push_back(0);
+    m_droneDiscovered.push_back(0);
+    m_dronePosition.push_back(CVector3());
+    m_droneHasPosition.push_back(false);
+
+    return m_droneIds.size() - 1;
+}
+
+/// @brief Get the number of drones added
+/// @return Number of drones
+UInt32 CCoverageMetrics::GetDroneCount() const { return m_droneIds.size(); }
+
+/// @brief Mark the cells seen by a drone during this step
+/// @param drone Index of the drone
+/// @param position Position of the drone
+/// @param yaw Orientation of the drone around Z
+/// @param distances Readings of the distance scanner, in cm
+/// @param isFlying False if the drone is on the ground and sees nothing
+void CCoverageMetrics::Update(
+    UInt32 drone, const CVector3& position, const CRadians& yaw,
+    const SensorDistance& distances, bool isFlying)
+{
+    if (m_droneHasPosition[drone])
+    {
+        m_droneDistance[drone] += (position - m_dronePosition[drone]).Length();
+    }
+    m_dronePosition[drone] = position;
+    m_droneHasPosition[drone] = true;
+
+    if (!isFlying)
+    {
+        return;
+    }
+
+    MarkCell(drone, position.GetX(), position.GetY());
+
+    // Only a ray that hit nothing sees up to the range of the scanner. A
+    // drone against a wall does not see behind it, so an obstacle that is
+    // too close, or any other negative reading, is a hit at distance 0.
+    const Real readings[] = {
+        distances.front, distances.left, distances.back, distances.right};
+    for (UInt32 ray = 0; ray < 4; ++ray)
+    {
+        Real length = 0.0;
+        if (readings[ray] == NOTHING_IN_RANGE)
+        {
+            length = m_sensorRange;
+        }
+        else if (readings[ray] >= 0.0)
+        {
+            length = std::min<Real>(readings[ray] / 100.0, m_sensorRange);
+        }
+        MarkRay(drone, position, yaw + CRadians::PI_OVER_TWO * ray, length);
+    }
+}
+
+/// @brief Add the covered area of this step to the history
+/// @param tick Current step
+/// @return Sample added
+const CoveragePoint& CCoverageMetrics::Sample(UInt32 tick)
+{
+    m_history.emplace_back(
+        tick, m_coveredCells * static_cast<float>(m_cellSize * m_cellSize));
+    return m_history.back();
+}
+
+/// @brief Build a report of the current metrics, in a report nobody holds
+/// anymore so its memory is not allocated again
+/// @param tick Current step
+/// @return Report that can be shared with the servers
+std::shared_ptr<const CoverageReport>
+CCoverageMetrics::GetReport(UInt32 tick) const
+{
+    std::shared_ptr<CoverageReport> report;
+    for (const std::shared_ptr<CoverageReport>& pooled : m_vecReportPool)
+    {
+        // Same as the frames, the reads of the last reader must happen
+        // before the report is written again
+        if (pooled.use_count() == 1)
+        {
+            std::atomic_thread_fence(std::memory_order_acquire);
+            report = pooled;
+            break;
+        }
+    }
+    if (!report)
+    {
+        report = std::make_shared<CoverageReport>();
+        if (m_vecReportPool.size() < MAX_POOLED_REPORTS)
+        {
+            m_vecReportPool.push_back(report);
+        }
+    }
+
+    report->tick = tick;
+    report->covered_area = m_coveredCells * m_cellSize * m_cellSize;
+    report->coverage_ratio =
+        m_cells.empty() ? 0.0f
+                        : static_cast<float>(m_coveredCells) / m_cells.size();
+    report->overlap_ratio =
+        m_coveredCells == 0
+            ? 0.0f
+            : static_cast<float>(m_sharedCells) / m_coveredCells;
+
+    // The uri of a reused report is assigned in place, in its own memory
+    std::vector<DroneCoverage>& drones = report->drones;
+    for (size_t i = 0; i < m_droneIds.size(); ++i)
+    {
+        if (i < drones.size())
+        {
+            drones[i].uri = m_droneIds[i];
+            drones[i].distance = m_droneDistance[i];
+            drones[i].discovered_cells = m_droneDiscovered[i];
+        }
+        else
+        {
+            drones.emplace_back(
+                m_droneIds[i], m_droneDistance[i], m_droneDiscovered[i]);
+        }
+    }
+    drones.erase(drones.begin() + m_droneIds.size(), drones.end());
+
+    return report;
+}
+
+/// @brief Write the history and the metrics of each drone
+/// @param prefix Prefix of the csv files
+void CCoverageMetrics::Write(const std::string& prefix) const
+{
+    std::ofstream historyFile(prefix + "_history.csv");
+    historyFile << "tick,covered_area" << std::endl;
+    for (const CoveragePoint& point : m_history)
+    {
+        historyFile << point.tick << "," << point.covered_area << std::endl;
+    }
+
+    std::shared_ptr<const CoverageReport> report =
+        GetReport(m_history.empty() ? 0 : m_history.back().tick);
+
+    std::ofstream dronesFile(prefix + "_drones.csv");
+    dronesFile << "id,distance,discovered_cells" << std::endl;
+    for (const DroneCoverage& drone : report->drones)
+    {
+        dronesFile << drone.uri << "," << drone.distance << ","
+                   << drone.discovered_cells << std::endl;
+    }
+
+    std::ofstream summaryFile(prefix + "_summary.csv");
+    summaryFile << "covered_area,coverage_ratio,overlap_ratio" << std::endl;
+    summaryFile << report->covered_area << "," << report->coverage_ratio << ","
+                << report->overlap_ratio << std::endl;
+}
+
+/// @brief Mark the cells along a ray, sampled twice per cell
+/// @param drone Index of the drone
+/// @param position Start of the ray
+/// @param angle Direction of the ray
+/// @param length Length of the ray, in meters
+void CCoverageMetrics::MarkRay(
+    UInt32 drone, const CVector3& position, const CRadians& angle,
+    Real length)
+{
+    UInt32 steps = static_cast<UInt32>(std::ceil(length / (m_cellSize * 0.5)));
+    Real dx = Cos(angle) * length / std::max<UInt32>(steps, 1);
+    Real dy = Sin(angle) * length / std::max<UInt32>(steps, 1);
+
+    for (UInt32 step = 1; step <= steps; ++step)
+    {
+        MarkCell(
+            drone, position.GetX() + dx * step, position.GetY() + dy * step);
+    }
+}
+
+/// @brief Mark a cell as seen by a drone and update the totals
+/// @param drone Index of the drone
+/// @param x X coordinate of a point in the cell
+/// @param y Y coordinate of a point in the cell
+void CCoverageMetrics::MarkCell(UInt32 drone, Real x, Real y)
+{
+    SInt32 cellX =
+        static_cast<SInt32>(std::floor((x - m_min.GetX()) / m_cellSize));
+    SInt32 cellY =
+        static_cast<SInt32>(std::floor((y - m_min.GetY()) / m_cellSize));
+    if (cellX < 0 || cellX >= m_cellsX || cellY < 0 || cellY >= m_cellsY)
+    {
+        return;
+    }
+
+    SInt32& cell = m_cells[cellY * m_cellsX + cellX];
+    if (cell == UNSEEN)
+    {
+        cell = drone;
+        ++m_coveredCells;
+        ++m_droneDiscovered[drone];
+    }
+    else if (cell != SHARED && cell != static_cast<SInt32>(drone))
+    {
+        cell = SHARED;
+        ++m_sharedCells;
+    }
+}
@@ -0,0 +1,110 @@
+/*
+ * Incremental exploration metrics of the swarm.
+ *
+ * The arena is split in cells. Every step, the cells under each drone and
+ * along its four distance rays are marked as seen. Each update only touches
+ * the cells crossed by the rays, and the totals (covered area, overlap
+ * between drones, distance flown) are kept up to date as cells change.
+ */
+
+#ifndef COVERAGE_METRICS_H
+#define COVERAGE_METRICS_H
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <argos3/core/utility/math/angles.h>
+#include <argos3/core/utility/math/vector3.h>
+
+#include <main_simulation/main_simulation.h>
+#include <struct/coverage.h>
+
+using namespace argos;
+
+class CCoverageMetrics
+{
+public:
+    CCoverageMetrics();
+
+    /*
+     * Sets the area covered, the size of the cells and the range of the
+     * distance scanner (used for rays that do not hit anything).
+     */
+    void Configure(
+        const CVector3& min, const CVector3& max, Real cellSize,
+        Real sensorRange);
+
+    /*
+     * Forgets the drones and every seen cell.
+     */
+    void Reset();
+
+    /*
+     * Returns the index of the drone, adding it if it is new.
+     */
+    UInt32 GetDroneIndex(const std::string& id);
+
+    /*
+     * Returns the number of drones added.
+     */
+    UInt32 GetDroneCount() const;
+
+    /*
+     * Marks the cells seen by the drone during this step.
+     */
+    void Update(
+        UInt32 drone, const CVector3& position, const CRadians& yaw,
+        const SensorDistance& distances, bool isFlying);
+
+    /*
+     * Adds the covered area of this step to the history and returns it.
+     */
+    const CoveragePoint& Sample(UInt32 tick);
+
+    /*
+     * Returns a report of the current metrics. The reports are reused once
+     * nobody holds them anymore.
+     */
+    std::shared_ptr<const CoverageReport> GetReport(UInt32 tick) const;
+
+    /*
+     * Writes the history and the metrics of each drone to csv files.
+     */
+    void Write(const std::string& prefix) const;
+
+private:
+    static const SInt32 UNSEEN = -1;
+    static const SInt32 SHARED = -2;
+
+    void MarkRay(
+        UInt32 drone, const CVector3& position, const CRadians& angle,
+        Real length);
+    void MarkCell(UInt32 drone, Real x, Real y);
+
+    CVector3 m_min;
+    Real m_cellSize;
+    Real m_sensorRange;
+    SInt32 m_cellsX;
+    SInt32 m_cellsY;
+
+    /* Drone that saw the cell first, UNSEEN or SHARED */
+    std::vector<SInt32> m_cells;
+    UInt32 m_coveredCells;
+    UInt32 m_sharedCells;
+
+    std::unordered_map<std::string, UInt32> m_droneIndex;
+    std::vector<std::string> m_droneIds;
+    std::vector<Real> m_droneDistance;
+    std::vector<UInt32> m_droneDiscovered;
+    std::vector<CVector3> m_dronePosition;
+    std::vector<bool> m_droneHasPosition;
+
+    std::vector<CoveragePoint> m_history;
+
+    /* Reports published recently, reused once only the pool holds them */
+    mutable std::vector<std::shared_ptr<CoverageReport>> m_vecReportPool;
+};
+
+#endif
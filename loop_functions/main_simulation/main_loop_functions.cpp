@@ -0,0 +1,414 @@
+#include "main_loop_functions.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+#include <argos3/core/simulator/physics_engine/physics_engine.h>
+#include <argos3/core/utility/configuration/argos_configuration.h>
+#include <argos3/core/utility/logging/argos_log.h>
+#include <argos3/plugins/robots/crazyflie/simulator/crazyflie_entity.h>
+
+#include <benchmark/allocation_counter.h>
+
+#include <communication/coverage_board.h>
+#include <communication/drone_registry.h>
+#include <communication/frame_board.h>
+#include <communication/pacing_board.h>
+#include <main_simulation/main_simulation.h>
+#include <main_simulation/spatial_hash.h>
+
+/* Frames kept for reuse, readers holding more frames get new ones */
+static const size_t MAX_POOLED_FRAMES = 8;
+
+/****************************************/
+/****************************************/
+
+/// @brief Constructor of the CMainLoopFunctions
+CMainLoopFunctions::CMainLoopFunctions()
+    : m_fCellSize(0.5), m_unCoveragePeriod(20), m_strCoverageOutput(""),
+      m_unControlPort(0), m_bFirstTick(true), m_unLastAllocationCount(0),
+      m_unTickAllocations(0), m_unMaxTickAllocations(0),
+      m_unTicksWithAllocations(0), m_unCountedTicks(0)
+{
+}
+
+/// @brief Read the parameters, size the spatial hash to the arena and start
+/// the servers of every drone
+/// @param t_tree <loop_functions> section of the XML file
+void CMainLoopFunctions::Init(TConfigurationNode& t_tree)
+{
+    GetNodeAttributeOrDefault(t_tree, "cell_size", m_fCellSize, m_fCellSize);
+
+    if (m_fCellSize <= 0)
+    {
+        THROW_ARGOSEXCEPTION("cell_size must be greater than 0");
+    }
+
+    CVector3 halfSize = GetSpace().GetArenaSize() * 0.5;
+    CVector3 center = GetSpace().GetArenaCenter();
+    CSpatialHash::GetInstance().Configure(
+        center - halfSize, center + halfSize, m_fCellSize);
+
+    Real coverageCellSize = 0.1;
+    Real sensorRange = 1.5;
+    if (NodeExists(t_tree, "coverage"))
+    {
+        TConfigurationNode& coverageNode = GetNode(t_tree, "coverage");
+        GetNodeAttributeOrDefault(
+            coverageNode, "cell_size", coverageCellSize, coverageCellSize);
+        GetNodeAttributeOrDefault(
+            coverageNode, "sensor_range", sensorRange, sensorRange);
+        GetNodeAttributeOrDefault(
+            coverageNode, "sampling_period", m_unCoveragePeriod,
+            m_unCoveragePeriod);
+        GetNodeAttributeOrDefault(
+            coverageNode, "output", m_strCoverageOutput, m_strCoverageOutput);
+    }
+
+    if (coverageCellSize <= 0 || m_unCoveragePeriod == 0)
+    {
+        THROW_ARGOSEXCEPTION(
+            "coverage cell_size and sampling_period must be greater than 0");
+    }
+
+    m_cCoverage.Configure(
+        center - halfSize, center + halfSize, coverageCellSize, sensorRange);
+
+    if (NodeExists(t_tree, "shm"))
+    {
+        TConfigurationNode& shmNode = GetNode(t_tree, "shm");
+        std::string name = "/inf3995_simulation";
+        UInt32 capacity = 65536;
+        GetNodeAttributeOrDefault(shmNode, "name", name, name);
+        GetNodeAttributeOrDefault(shmNode, "capacity", capacity, capacity);
+
+        if (!m_cShmRing.Open(name, capacity))
+        {
+            THROW_ARGOSEXCEPTION("Could not create shared memory " << name);
+        }
+    }
+
+    // The simulation runs as fast as possible unless a factor is given
+    Real realTimeFactor = 0;
+    if (NodeExists(t_tree, "pacing"))
+    {
+        GetNodeAttributeOrDefault(
+            GetNode(t_tree, "pacing"), "real_time_factor", realTimeFactor,
+            realTimeFactor);
+    }
+    m_cPacer.Configure(
+        CPhysicsEngine::GetInverseSimulationClockTick(), realTimeFactor);
+
+    if (NodeExists(t_tree, "control"))
+    {
+        GetNodeAttribute(GetNode(t_tree, "control"), "port", m_unControlPort);
+        if (m_unControlPort == 0 || m_unControlPort > 65535)
+        {
+            THROW_ARGOSEXCEPTION("control port must be between 1 and 65535");
+        }
+    }
+
+    StartServers(t_tree);
+}
+
+/// @brief Start the servers of every drone at once, after all the
+/// controllers were initialized
+/// @param t_tree <loop_functions> section of the XML file
+void CMainLoopFunctions::StartServers(TConfigurationNode& t_tree)
+{
+    UInt32 threads = std::thread::hardware_concurrency();
+    GetNodeAttributeOrDefault(t_tree, "server_threads", threads, threads);
+
+    m_tStartup = std::chrono::steady_clock::now();
+    DroneRegistry& registry = DroneRegistry::GetInstance();
+    std::vector<std::string> failed = registry.StartServers(threads);
+
+    if (!failed.empty())
+    {
+        THROW_ARGOSEXCEPTION(
+            "Could not start the server of " << failed.size()
+                                             << " drones, first is \""
+                                             << failed.front() << "\"");
+    }
+
+    LOG << "Started " << registry.GetUris().size() << " servers in "
+        << std::chrono::duration<double, std::milli>(
+               std::chrono::steady_clock::now() - m_tStartup)
+               .count()
+        << " ms" << std::endl;
+
+    if (m_unControlPort == 0)
+    {
+        return;
+    }
+
+    // It serves the requests about the whole simulation (ListDrones,
+    // GroupCommand, Subscribe to "all", GetCoverage, GetSwarmFrame,
+    // GetPacing), its own drone requests have no drone behind them
+    m_cControlServer.Configure(
+        "0.0.0.0:" + std::to_string(m_unControlPort), ServerOptions());
+    if (!m_cControlServer.Start())
+    {
+        THROW_ARGOSEXCEPTION(
+            "Could not start the control server on port " << m_unControlPort);
+    }
+    LOG << "Control server listening on port " << m_unControlPort
+        << std::endl;
+}
+
+/// @brief Forget the exploration metrics and the tick timings
+void CMainLoopFunctions::Reset()
+{
+    m_cCoverage.Reset();
+    CoverageBoard::GetInstance().ClearHistory();
+    m_cPacer.Reset();
+}
+
+/// @brief Get a frame to fill for this tick, a frame is reused once the
+/// pool is its only holder so its memory is not allocated again
+/// @param tick Tick of the frame
+/// @return Frame, with the drones of its previous tick
+std::shared_ptr<TickFrame> CMainLoopFunctions::AcquireFrame(UInt32 tick)
+{
+    for (std::shared_ptr<TickFrame>& frame : m_vecFramePool)
+    {
+        // Nobody can take a new reference to a frame only held by the pool.
+        // The count is read relaxed, the reads of the last reader that
+        // released the frame must happen before it is written again.
+        if (frame.use_count() == 1)
+        {
+            std::atomic_thread_fence(std::memory_order_acquire);
+            frame->tick = tick;
+            return frame;
+        }
+    }
+
+    auto frame = std::make_shared<TickFrame>(tick);
+    if (m_vecFramePool.size() < MAX_POOLED_FRAMES)
+    {
+        m_vecFramePool.push_back(frame);
+    }
+    return frame;
+}
+
+/// @brief Count the heap allocations made by the simulation thread since the
+/// previous tick. The servers run on their own threads and are not counted,
+/// the controllers are counted when they run on this thread (threads="0").
+void CMainLoopFunctions::CountAllocations()
+{
+    if (!simulation_thread_allocation_count)
+    {
+        return;
+    }
+
+    UInt64 count = simulation_thread_allocation_count();
+    m_unTickAllocations = count - m_unLastAllocationCount;
+    m_unLastAllocationCount = count;
+
+    // The first tick fills the pools and is not counted
+    if (m_unCountedTicks++ == 0)
+    {
+        return;
+    }
+
+    m_unMaxTickAllocations =
+        std::max(m_unMaxTickAllocations, m_unTickAllocations);
+    if (m_unTickAllocations > 0)
+    {
+        ++m_unTicksWithAllocations;
+    }
+}
+
+/// @brief Get the number of heap allocations during the last tick
+/// @return Number of allocations, 0 if they are not counted
+UInt64 CMainLoopFunctions::GetTickAllocations() const
+{
+    return m_unTickAllocations;
+}
+
+/// @brief Start timing the tick and put every drone in the spatial hash
+/// before the controllers run
+void CMainLoopFunctions::PreStep()
+{
+    m_cPacer.StartTick();
+
+    if (m_bFirstTick)
+    {
+        m_bFirstTick = false;
+        LOG << "First tick "
+            << std::chrono::duration<double, std::milli>(
+                   std::chrono::steady_clock::now() - m_tStartup)
+                   .count()
+            << " ms after the start of the servers" << std::endl;
+    }
+
+    CSpatialHash& spatialHash = CSpatialHash::GetInstance();
+    spatialHash.Clear();
+
+    CSpace::TMapPerType& drones = GetSpace().GetEntitiesByType("crazyflie");
+    for (auto& [id, entity] : drones)
+    {
+        CCrazyflieEntity& drone = *any_cast<CCrazyflieEntity*>(entity);
+        CCI_Controller& controller =
+            drone.GetControllableEntity().GetController();
+
+        // A sleeping drone is landed, the flying drones have nothing to avoid
+        if (dynamic_cast<CMainSimulation&>(controller).IsDormant())
+        {
+            continue;
+        }
+
+        spatialHash.Insert(
+            &controller, drone.GetEmbodiedEntity().GetOriginAnchor().Position);
+    }
+
+    spatialHash.Build();
+}
+
+/// @brief Update the exploration metrics after the controllers ran, publish
+/// the state of the swarm to the servers and wait for the next tick
+void CMainLoopFunctions::PostStep()
+{
+    UInt32 tick = GetSpace().GetSimulationClock();
+    std::shared_ptr<TickFrame> frame = AcquireFrame(tick);
+    m_vecControllers.clear();
+
+    // The state of a sleeping drone is copied from the previous frame
+    std::shared_ptr<const TickFrame> previousFrame =
+        FrameBoard::GetInstance().Get();
+
+    CSpace::TMapPerType& drones = GetSpace().GetEntitiesByType("crazyflie");
+    frame->drones.reserve(drones.size());
+    size_t index = 0;
+    for (auto& [id, entity] : drones)
+    {
+        CCrazyflieEntity& drone = *any_cast<CCrazyflieEntity*>(entity);
+        const CPositionalEntity& anchor =
+            drone.GetEmbodiedEntity().GetOriginAnchor();
+        CMainSimulation& controller = dynamic_cast<CMainSimulation&>(
+            drone.GetControllableEntity().GetController());
+
+        // A sleeping drone is landed and does not move, it covers nothing.
+        // It is still added on its first tick, so the drones keep the order
+        // of the frame.
+        if (!controller.IsDormant() || index >= m_cCoverage.GetDroneCount())
+        {
+            CRadians yaw;
+            CRadians pitch;
+            CRadians roll;
+            anchor.Orientation.ToEulerAngles(yaw, pitch, roll);
+
+            m_cCoverage.Update(
+                m_cCoverage.GetDroneIndex(id), anchor.Position, yaw,
+                controller.GetDistances(),
+                controller.GetCurrentAction() != Action::None);
+        }
+
+        // The uri of a reused frame is assigned in place, in its own memory
+        if (index < frame->drones.size())
+        {
+            frame->drones[index].uri = id;
+        }
+        else
+        {
+            frame->drones.emplace_back(id);
+        }
+
+        DroneFrame& droneFrame = frame->drones[index];
+        if (!controller.IsPublishing() && previousFrame &&
+            index < previousFrame->drones.size() &&
+            previousFrame->drones[index].uri == id)
+        {
+            // Its logs were already published, the new ones wait for the
+            // heartbeat
+            const DroneFrame& previous = previousFrame->drones[index];
+            droneFrame.metric = previous.metric;
+            droneFrame.distance = previous.distance;
+            droneFrame.logs.clear();
+        }
+        else
+        {
+            controller.FillFrame(&droneFrame);
+        }
+        m_vecControllers.push_back(&controller);
+        ++index;
+    }
+    frame->drones.erase(frame->drones.begin() + index, frame->drones.end());
+
+    // Readers of the board always see the whole swarm at the same tick
+    std::shared_ptr<const TickFrame> publishedFrame = std::move(frame);
+    FrameBoard::GetInstance().Publish(publishedFrame);
+    for (size_t i = 0; i < m_vecControllers.size(); ++i)
+    {
+        // Sleeping drones only publish at their heartbeat, so the cost of a
+        // tick follows the number of active drones
+        if (m_vecControllers[i]->IsPublishing())
+        {
+            m_vecControllers[i]->GetServer().PublishFrame(publishedFrame, i);
+        }
+    }
+
+    if (m_cShmRing.IsOpen())
+    {
+        uint64_t timestamp =
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch())
+                .count();
+        for (size_t i = 0; i < m_vecControllers.size(); ++i)
+        {
+            if (!m_vecControllers[i]->IsPublishing())
+            {
+                continue;
+            }
+
+            const DroneFrame& drone = publishedFrame->drones[i];
+            m_cShmRing.Write(WireSample(
+                timestamp, tick, m_vecControllers[i]->GetSlot(), drone.metric,
+                drone.distance));
+        }
+    }
+
+    if (tick % m_unCoveragePeriod == 0)
+    {
+        CoverageBoard& board = CoverageBoard::GetInstance();
+        board.AppendHistory(m_cCoverage.Sample(tick));
+        board.Publish(m_cCoverage.GetReport(tick));
+    }
+
+    CountAllocations();
+
+    m_cPacer.EndTick(tick);
+    PacingBoard::GetInstance().Publish(m_cPacer.GetReport());
+}
+
+/// @brief Write the exploration metrics at the end of the run
+void CMainLoopFunctions::Destroy()
+{
+    if (!m_strCoverageOutput.empty())
+    {
+        m_cCoverage.Write(m_strCoverageOutput);
+    }
+
+    m_cShmRing.Close();
+    m_cControlServer.Stop();
+
+    const PacingReport& pacing = m_cPacer.GetReport();
+    if (pacing.ticks > 0)
+    {
+        LOG << pacing.overruns << " of " << pacing.ticks
+            << " ticks took longer than their budget of " << pacing.budget_us
+            << " us (mean " << pacing.mean_tick_us << " us, max "
+            << pacing.max_tick_us << " us), ran at "
+            << pacing.achieved_factor << "x real time" << std::endl;
+    }
+
+    if (simulation_thread_allocation_count && m_unCountedTicks > 1)
+    {
+        LOG << m_unTicksWithAllocations << " of " << m_unCountedTicks - 1
+            << " ticks made heap allocations, at most "
+            << m_unMaxTickAllocations << " in a tick" << std::endl;
+    }
+}
+
+REGISTER_LOOP_FUNCTIONS(CMainLoopFunctions, "main_loop_functions")
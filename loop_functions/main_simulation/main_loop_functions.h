@@ -0,0 +1,147 @@
+/*
+ * Loop functions of the main simulation.
+ *
+ * Once every controller is initialized, the servers of all the drones are
+ * started together. With the <control> node, a server that belongs to no
+ * drone is also started, so the simulation can be reached even without any
+ * drone (the gateway addresses the shards through it).
+ *
+ * Before the controllers are stepped, the positions of every drone are put
+ * in the shared spatial hash so each controller can find its neighbors.
+ * After they are stepped, the state of every drone is gathered in one frame
+ * that is published to the servers, and the exploration metrics are updated.
+ * The samples of the drones can also be written in a shared memory ring for
+ * the backends running on the same host.
+ *
+ * Every tick is timed against its budget at the real time factor of the
+ * <pacing> node, and the simulation is slowed down to that factor. The
+ * timings are published to the servers.
+ *
+ * The frames and the coverage reports are reused once nobody holds them
+ * anymore, and the logs of the drones are string literals. Once the pools
+ * are filled and while nobody subscribes to the drones, a tick only
+ * allocates when a history grows: a new segment of a drone history until
+ * its retention is reached, and the coverage history at its sampling ticks.
+ * When the allocation counter of benchmark/ is preloaded, the allocations
+ * made by the simulation thread during every tick are counted to check it.
+ *
+ * This loop function is meant to be used with the XML file:
+ *    experiments/main_simulation.argos
+ */
+
+#ifndef MAIN_LOOP_FUNCTIONS_H
+#define MAIN_LOOP_FUNCTIONS_H
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <argos3/core/simulator/loop_functions.h>
+
+#include <communication/shm_ring.h>
+#include <main_simulation/main_simulation.h>
+
+#include "coverage_metrics.h"
+#include "pacer.h"
+
+using namespace argos;
+
+class CMainLoopFunctions : public CLoopFunctions
+{
+public:
+    CMainLoopFunctions();
+    virtual ~CMainLoopFunctions() {}
+
+    /*
+     * Sizes the spatial hash to the arena and starts the servers.
+     */
+    virtual void Init(TConfigurationNode& t_tree);
+
+    /*
+     * Forgets the exploration metrics.
+     */
+    virtual void Reset();
+
+    /*
+     * Starts timing the tick and rebuilds the spatial hash with the current
+     * drone positions.
+     */
+    virtual void PreStep();
+
+    /*
+     * Publishes the frame of the tick, updates the exploration metrics and
+     * waits for the next tick at the real time factor.
+     */
+    virtual void PostStep();
+
+    /*
+     * Writes the exploration metrics and the timing summary, and removes the
+     * shared memory ring.
+     */
+    virtual void Destroy();
+
+    /*
+     * Number of heap allocations during the last tick, 0 when the allocation
+     * counter is not preloaded.
+     */
+    UInt64 GetTickAllocations() const;
+
+private:
+    /*
+     * Starts the servers of every drone on several threads, and the control
+     * server.
+     */
+    void StartServers(TConfigurationNode& t_tree);
+
+    /*
+     * Gets a frame nobody holds anymore, or a new one.
+     */
+    std::shared_ptr<TickFrame> AcquireFrame(UInt32 tick);
+
+    /*
+     * Counts the allocations made since the last tick.
+     */
+    void CountAllocations();
+
+    /* Size of the cells of the spatial hash */
+    Real m_fCellSize;
+
+    CCoverageMetrics m_cCoverage;
+
+    /* The metrics are sampled and published every m_unCoveragePeriod ticks */
+    UInt32 m_unCoveragePeriod;
+
+    /* Prefix of the coverage files, nothing is written if empty */
+    std::string m_strCoverageOutput;
+
+    /* Paces the ticks at the real time factor and times them */
+    CPacer m_cPacer;
+
+    /* Shared memory ring, only opened when the <shm> node exists */
+    ShmRingWriter m_cShmRing;
+
+    /* Server of the simulation itself, only started when m_unControlPort is
+     * not 0 */
+    SimulationServer m_cControlServer;
+    UInt32 m_unControlPort;
+
+    /* Start of the servers, used to time the first tick */
+    std::chrono::steady_clock::time_point m_tStartup;
+    bool m_bFirstTick;
+
+    /* Controllers in the order of the frame, kept to reuse the memory */
+    std::vector<CMainSimulation*> m_vecControllers;
+
+    /* Frames published recently, reused once only the pool holds them */
+    std::vector<std::shared_ptr<TickFrame>> m_vecFramePool;
+
+    /* Heap allocations of the last tick and over the whole run */
+    UInt64 m_unLastAllocationCount;
+    UInt64 m_unTickAllocations;
+    UInt64 m_unMaxTickAllocations;
+    UInt32 m_unTicksWithAllocations;
+    UInt32 m_unCountedTicks;
+};
+
+#endif
@@ -0,0 +1,105 @@
+#include "pacer.h"
+
+#include <algorithm>
+#include <thread>
+
+#include <argos3/core/utility/configuration/argos_exception.h>
+
+/****************************************/
+/****************************************/
+
+/// @brief Constructor of the CPacer, runs as fast as possible at 10 ticks
+/// per second until it is configured
+CPacer::CPacer() { Configure(10, 0); }
+
+/// @brief Set the rate of the simulation
+/// @param ticksPerSecond Number of ticks per simulated second
+/// @param realTimeFactor Simulated time per wall time, 0 to run as fast as
+/// possible
+void CPacer::Configure(Real ticksPerSecond, Real realTimeFactor)
+{
+    if (ticksPerSecond <= 0 || realTimeFactor < 0)
+    {
+        THROW_ARGOSEXCEPTION(
+            "ticks per second must be greater than 0 and real_time_factor "
+            "must be positive");
+    }
+
+    m_fRealTimeFactor = realTimeFactor;
+    m_fTickLength = 1 / ticksPerSecond;
+
+    Real budget = m_fTickLength / (realTimeFactor > 0 ? realTimeFactor : 1);
+    m_tBudget = std::chrono::duration_cast<TClock::duration>(
+        std::chrono::duration<Real>(budget));
+    m_tPeriod = realTimeFactor > 0 ? m_tBudget : TClock::duration::zero();
+
+    Reset();
+}
+
+/// @brief Forget the timings and restart the schedule at the next tick
+void CPacer::Reset()
+{
+    m_unTotalTickTime = 0;
+    m_sReport = PacingReport();
+    m_sReport.real_time_factor = m_fRealTimeFactor;
+    m_sReport.budget_us =
+        std::chrono::duration_cast<std::chrono::microseconds>(m_tBudget)
+            .count();
+}
+
+/// @brief Start timing a tick
+void CPacer::StartTick()
+{
+    m_tTickStart = TClock::now();
+    if (m_sReport.ticks == 0)
+    {
+        m_tFirstTick = m_tTickStart;
+        m_tNextTick = m_tTickStart;
+    }
+}
+
+/// @brief Stop timing the tick and wait for the start of the next one
+/// @param tick Tick that just ended
+void CPacer::EndTick(UInt32 tick)
+{
+    TClock::time_point now = TClock::now();
+    TClock::duration tickTime = now - m_tTickStart;
+    uint64_t tickTimeUs =
+        std::chrono::duration_cast<std::chrono::microseconds>(tickTime)
+            .count();
+
+    m_unTotalTickTime += tickTimeUs;
+    ++m_sReport.ticks;
+    m_sReport.tick = tick;
+    m_sReport.last_tick_us = tickTimeUs;
+    m_sReport.mean_tick_us = m_unTotalTickTime / m_sReport.ticks;
+    m_sReport.max_tick_us = std::max(m_sReport.max_tick_us, tickTimeUs);
+    if (tickTime > m_tBudget)
+    {
+        ++m_sReport.overruns;
+    }
+
+    if (m_fRealTimeFactor > 0)
+    {
+        // The next tick starts one period after the start of this one on the
+        // schedule, a simulation more than a tick late restarts from now
+        m_tNextTick += m_tPeriod;
+        if (now - m_tNextTick > m_tPeriod)
+        {
+            m_tNextTick = now;
+        }
+        std::this_thread::sleep_until(m_tNextTick);
+        now = TClock::now();
+    }
+
+    Real wallTime = std::chrono::duration<Real>(now - m_tFirstTick).count();
+    if (wallTime > 0)
+    {
+        m_sReport.achieved_factor =
+            m_sReport.ticks * m_fTickLength / wallTime;
+    }
+}
+
+/// @brief Get the timings of the ticks
+/// @return Report of the last tick
+const PacingReport& CPacer::GetReport() const { return m_sReport; }
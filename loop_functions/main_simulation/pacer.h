@@ -0,0 +1,82 @@
+/*
+ * Paces the simulation at a real time factor and times every tick.
+ *
+ * A tick has a budget of one simulated tick divided by the real time factor
+ * (50 ms at 20 ticks per second and a factor of 1). The wall time of the
+ * work of each tick is compared to its budget, and the ticks that exceed it
+ * are counted as overruns. When the simulation is paced, the pacer then
+ * sleeps until the start of the next tick. A late tick does not make the
+ * following ones run back to back to catch up: once the simulation is more
+ * than a tick late, the schedule restarts from the current time.
+ *
+ * With a factor of 0, the simulation runs as fast as possible and the ticks
+ * are only timed against the real time budget.
+ */
+
+#ifndef PACER_H
+#define PACER_H
+
+#include <chrono>
+
+#include <argos3/core/utility/datatypes/datatypes.h>
+
+#include <struct/pacing.h>
+
+using namespace argos;
+
+class CPacer
+{
+public:
+    CPacer();
+
+    /*
+     * Sets the number of ticks per simulated second and the real time
+     * factor, 0 to run as fast as possible.
+     */
+    void Configure(Real ticksPerSecond, Real realTimeFactor);
+
+    /*
+     * Forgets the timings and restarts the schedule.
+     */
+    void Reset();
+
+    /*
+     * Starts timing a tick, before the controllers are stepped.
+     */
+    void StartTick();
+
+    /*
+     * Stops timing the tick, then waits for the start of the next one when
+     * the simulation is paced.
+     */
+    void EndTick(UInt32 tick);
+
+    /*
+     * Timings of the ticks since the start of the simulation.
+     */
+    const PacingReport& GetReport() const;
+
+private:
+    typedef std::chrono::steady_clock TClock;
+
+    Real m_fRealTimeFactor;
+
+    /* Wall time of a tick at the real time factor, or in real time */
+    TClock::duration m_tPeriod;
+    TClock::duration m_tBudget;
+
+    /* Simulated time of a tick, in seconds */
+    Real m_fTickLength;
+
+    /* Wall time of the first tick, of the current tick and of the next */
+    TClock::time_point m_tFirstTick;
+    TClock::time_point m_tTickStart;
+    TClock::time_point m_tNextTick;
+
+    /* Sum of the tick times, for the mean */
+    UInt64 m_unTotalTickTime;
+
+    PacingReport m_sReport;
+};
+
+#endif
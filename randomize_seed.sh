@@ -1,2 +1,6 @@
 #!/bin/bash
-sed -i -E -e "s/random_seed=\".+\"/random_seed=\"$RANDOM\"/" experiments/main_simulation.argos
+# Usage: randomize_seed.sh [seed] [config]
+# Without a seed, a random one is chosen (the run is then not reproducible).
+seed=${1:-$RANDOM}
+config=${2:-experiments/main_simulation.argos}
+sed -i -E -e "s/random_seed=\".+\"/random_seed=\"$seed\"/" $config
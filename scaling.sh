@@ -0,0 +1,63 @@
+#!/bin/bash
+
+# Run the scaling suite headless: every scenario of the suite is generated,
+# run once, and its tick times and peak memory are appended to
+# scaling_results.csv, so the curves can be compared between commits.
+# Usage: scaling.sh [suite] [length in seconds]
+
+suite=${1:-experiments/scaling/suite.txt}
+length=${2:-60}
+output_dir=scaling_output
+results=scaling_results.csv
+seed=1
+
+mkdir -p $output_dir
+if [ ! -f $results ]
+then
+    echo "commit,name,drones,layout,ticks,mean_us,p99_us,max_us,max_rss_kb,overruns" > $results
+fi
+
+commit=$(git rev-parse --short HEAD 2>/dev/null || echo "unknown")
+failed=0
+
+while read -r name drones size layout
+do
+    case $name in
+      ""|\#*) continue ;;
+    esac
+
+    prefix=$output_dir/$name
+    python3 tools/generate_scenario.py $prefix.argos --drones $drones \
+        --size $size --layout $layout --length $length --seed $seed \
+        --headless > /dev/null || { failed=1; continue; }
+
+    echo "==== $name: $drones drones ===="
+    # The peak memory of argos3 is its max resident set size, in kB
+    if ! python3 -c '
+import resource, subprocess, sys
+code = subprocess.call(sys.argv[2:], stdout=sys.stdout, stderr=sys.stderr)
+with open(sys.argv[1], "w") as file:
+    print(resource.getrusage(resource.RUSAGE_CHILDREN).ru_maxrss, file=file)
+sys.exit(code)' $prefix.rss argos3 -c $prefix.argos > $prefix.log 2>&1
+    then
+        echo "argos3 failed, see $prefix.log"
+        failed=1
+        continue
+    fi
+
+    # The overruns are the ones counted by the pacer, in its summary
+    overruns=$(grep -o '[0-9]* of [0-9]* ticks took longer' $prefix.log \
+        | tail -n 1 | cut -d' ' -f1)
+    tail -n +2 $prefix"_timing.csv" | sort -t, -k2 -g | awk -F, \
+        -v commit=$commit -v name=$name -v drones=$drones -v layout=$layout \
+        -v rss=$(tail -n 1 $prefix.rss) -v overruns=${overruns:-0} '
+        { times[n++] = $2; total += $2 }
+        END {
+            if (n == 0) { exit }
+            printf "%s,%s,%d,%s,%d,%.1f,%.1f,%.1f,%d,%d\n", commit, name,
+                drones, layout, n, total / n, times[int(n * 0.99)],
+                times[n - 1], rss, overruns
+        }' | tee -a $results
+done < $suite
+
+exit $failed
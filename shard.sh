@@ -0,0 +1,29 @@
+#!/bin/bash
+
+# Run an experiment split in regions, one argos3 process per region pinned to
+# its own core, behind a gateway listening on a single port.
+# Usage: shard.sh <shards> [config] [gateway port] [min,max along X]
+
+set -m
+trap 'kill $(jobs -p); printf "\nExiting\n"; exit' SIGINT SIGTERM
+
+shards=${1:?Usage: shard.sh <shards> [config] [gateway port] [min,max]}
+config=${2:-experiments/main_simulation.argos}
+gateway_port=${3:-9850}
+bounds=${4:+--bounds=$4}
+cores=$(nproc)
+
+shard_addresses=()
+while read -r shard_config port
+do
+    shard=${#shard_addresses[@]}
+    taskset -c $((shard % cores)) argos3 -c $shard_config &
+    shard_addresses+=("localhost:$port")
+done < <(python3 tools/shard_experiment.py $config $shards --output shards $bounds)
+
+build/gateway/simulation_gateway $gateway_port "${shard_addresses[@]}" &
+
+while true
+do
+  sleep 1
+done
@@ -3,7 +3,17 @@
 set -m
 trap 'kill $(jobs -p); printf "\nExiting\n"; exit' SIGINT SIGTERM
 
-bash randomize_seed.sh
+# The seed in the experiment is kept unless one is given, so runs are
+# reproducible. Set SIMULATION_SEED=random to get a new seed at each start.
+if [ -n "$SIMULATION_SEED" ]
+then
+    if [ "$SIMULATION_SEED" = "random" ]
+    then
+        bash randomize_seed.sh "" experiments/$1
+    else
+        bash randomize_seed.sh $SIMULATION_SEED experiments/$1
+    fi
+fi
 
 python3 -m http.server --directory /root/client $WEBVIZ_PORT &
 argos3 -c experiments/$1 &
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+struct DroneCoverage{
+  std::string uri;
+  float distance;
+  unsigned int discovered_cells;
+
+  DroneCoverage(std::string uri, float distance, unsigned int discovered_cells):
+    uri(uri),
+    distance(distance),
+    discovered_cells(discovered_cells)
+  {}
+};
+
+struct CoveragePoint{
+  unsigned int tick;
+  float covered_area;
+
+  CoveragePoint():
+    tick(0),
+    covered_area(0)
+  {}
+
+  CoveragePoint(unsigned int tick, float covered_area):
+    tick(tick),
+    covered_area(covered_area)
+  {}
+};
+
+struct CoverageReport{
+  unsigned int tick;
+  float covered_area;
+  float coverage_ratio;
+  float overlap_ratio;
+  std::vector<DroneCoverage> drones;
+
+  CoverageReport():
+    tick(0),
+    covered_area(0),
+    coverage_ratio(0),
+    overlap_ratio(0)
+  {}
+};
@@ -1,13 +1,33 @@
 #pragma once
 
-#include <string>
+#include <cstddef>
 
+// A log only keeps pointers, so it is copied into the frames and the
+// histories without any allocation. It outlives the tick, so it can only be
+// built from string literals: an array that is not const, or a pointer from
+// c_str(), does not compile.
 struct LogData{
-  std::string message;
-  std::string level;
+  LogData():
+    m_message(""),
+    m_level("")
+  {}
 
-  LogData(std::string message, std::string level):
-    message(message),
-    level(level)
+  template <size_t M, size_t L>
+  LogData(const char (&message)[M], const char (&level)[L]):
+    m_message(message),
+    m_level(level)
   {}
+
+  template <size_t M, size_t L>
+  LogData(char (&message)[M], const char (&level)[L]) = delete;
+
+  template <size_t M, size_t L>
+  LogData(const char (&message)[M], char (&level)[L]) = delete;
+
+  const char* message() const { return m_message; }
+  const char* level() const { return m_level; }
+
+private:
+  const char* m_message;
+  const char* m_level;
 };
@@ -8,6 +8,12 @@ struct Metric{
   Position position;
   float battery_level;
 
+  Metric():
+    status(0),
+    position(0, 0, 0),
+    battery_level(0)
+  {}
+
   Metric(int status, Position position, float battery_level):
     status(status),
     position(position),
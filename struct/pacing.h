@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+
+struct PacingReport{
+  unsigned int tick;
+  // Ticks timed since the start of the simulation
+  unsigned int ticks;
+  // Ticks that took longer than their budget
+  unsigned int overruns;
+  // Real time factor asked for, 0 when the simulation is not paced
+  float real_time_factor;
+  // Simulated time over wall time since the first tick
+  float achieved_factor;
+  uint64_t budget_us;
+  uint64_t last_tick_us;
+  uint64_t mean_tick_us;
+  uint64_t max_tick_us;
+
+  PacingReport():
+    tick(0),
+    ticks(0),
+    overruns(0),
+    real_time_factor(0),
+    achieved_factor(0),
+    budget_us(0),
+    last_tick_us(0),
+    mean_tick_us(0),
+    max_tick_us(0)
+  {}
+};
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "distance_reading.h"
+#include "log.h"
+#include "metric.h"
+
+struct DroneFrame{
+  std::string uri;
+  Metric metric;
+  DistanceReadings distance;
+  std::vector<LogData> logs;
+
+  DroneFrame(std::string uri):
+    uri(std::move(uri))
+  {}
+};
+
+struct TickFrame{
+  unsigned int tick;
+  std::vector<DroneFrame> drones;
+
+  TickFrame(unsigned int tick):
+    tick(tick)
+  {}
+};
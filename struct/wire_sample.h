@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <type_traits>
+
+#include "distance_reading.h"
+#include "metric.h"
+
+// Metric and distances of a drone at a tick, as written in the shared memory
+// ring. It is packed and trivially copyable so a reader in another process
+// copies it as is, without any decoding.
+#pragma pack(push, 1)
+struct WireSample{
+  // std::chrono::steady_clock at the time of writing, in nanoseconds
+  uint64_t timestamp_ns;
+  uint32_t tick;
+  // Slot of the drone, see ListDrones for its uri
+  uint16_t slot;
+  int16_t status;
+  float position[3];
+  float battery_level;
+  // front, back, left, right
+  float distances[4];
+
+  WireSample() = default;
+
+  WireSample(uint64_t timestamp_ns, uint32_t tick, uint16_t slot, const Metric& metric, const DistanceReadings& distance):
+    timestamp_ns(timestamp_ns),
+    tick(tick),
+    slot(slot),
+    status(static_cast<int16_t>(metric.status)),
+    position{metric.position.posX, metric.position.posY, metric.position.posZ},
+    battery_level(metric.battery_level),
+    distances{distance.front, distance.back, distance.left, distance.right}
+  {}
+};
+#pragma pack(pop)
+
+static_assert(std::is_trivially_copyable<WireSample>::value, "WireSample is copied as raw bytes");
+static_assert(sizeof(WireSample) == 48, "WireSample layout is shared with the readers");
@@ -0,0 +1,341 @@
+#!/usr/bin/env python3
+"""Generate an experiment with a large arena, obstacles and many drones.
+
+The controllers, loop functions, physics engines and media of a base
+experiment are kept, so the drones use its controller configurations (given
+to the drones in turn with --controller ssc,uturn). Only the arena is
+replaced: walls around it, obstacles laid out as a pillar field, rooms or a
+maze, and the drones on a grid in the corner of the base. The same seed
+always gives the same obstacles.
+"""
+
+import argparse
+import math
+import random
+import xml.etree.ElementTree as ET
+
+from shard_experiment import format_vector, load, parse_vector
+
+WALL_THICKNESS = 0.05
+WALL_HEIGHT = 2.0
+DRONE_SPACING = 0.4
+
+# Density used when none is given: part of the area covered by the pillars,
+# part of the walls kept for the rooms and the maze
+DEFAULT_DENSITY = {"empty": 0.0, "pillars": 0.05, "rooms": 1.0, "maze": 0.9}
+
+
+class Arena:
+    def __init__(self, element, width, height):
+        self.element = element
+        self.width = width
+        self.height = height
+        self.boxes = 0
+
+    def add_box(self, x, y, size_x, size_y, yaw=0):
+        box = ET.SubElement(
+            self.element, "box",
+            {"id": "obstacle_{}".format(self.boxes),
+             "size": format_vector([size_x, size_y, WALL_HEIGHT]),
+             "movable": "false"})
+        ET.SubElement(
+            box, "body",
+            {"position": format_vector([x, y, 0]),
+             "orientation": format_vector([yaw, 0, 0])})
+        self.boxes += 1
+
+    def add_wall(self, start, end):
+        """Add a wall along X or Y between two points."""
+        (x1, y1), (x2, y2) = start, end
+        if abs(x2 - x1) > abs(y2 - y1):
+            self.add_box((x1 + x2) / 2, y1, abs(x2 - x1), WALL_THICKNESS)
+        else:
+            self.add_box(x1, (y1 + y2) / 2, WALL_THICKNESS, abs(y2 - y1))
+
+
+class SpawnZone:
+    """Corner of the arena where the drones start, kept free of obstacles."""
+
+    def __init__(self, arena, drones):
+        self.columns = max(1, math.ceil(math.sqrt(drones)))
+        rows = math.ceil(drones / self.columns)
+        self.min_x = -arena.width / 2 + 0.5
+        self.min_y = -arena.height / 2 + 0.5
+        self.max_x = self.min_x + (self.columns - 1) * DRONE_SPACING + 0.5
+        self.max_y = self.min_y + (rows - 1) * DRONE_SPACING + 0.5
+
+        if self.max_x > arena.width / 2 or self.max_y > arena.height / 2:
+            raise ValueError("The arena is too small for the drones")
+
+    def position(self, index):
+        return (self.min_x + (index % self.columns) * DRONE_SPACING,
+                self.min_y + (index // self.columns) * DRONE_SPACING)
+
+    def overlaps(self, min_x, min_y, max_x, max_y):
+        return (min_x < self.max_x + 0.5 and max_x > self.min_x - 0.5 and
+                min_y < self.max_y + 0.5 and max_y > self.min_y - 0.5)
+
+
+def add_border(arena):
+    half_x = arena.width / 2
+    half_y = arena.height / 2
+    arena.add_wall((-half_x, half_y), (half_x, half_y))
+    arena.add_wall((-half_x, -half_y), (half_x, -half_y))
+    arena.add_wall((half_x, -half_y), (half_x, half_y))
+    arena.add_wall((-half_x, -half_y), (-half_x, half_y))
+
+
+def add_pillars(arena, spawn, density, rng, pillar_size=0.3):
+    count = int(density * arena.width * arena.height / pillar_size ** 2)
+    margin = pillar_size
+    for _ in range(count):
+        x = rng.uniform(-arena.width / 2 + margin, arena.width / 2 - margin)
+        y = rng.uniform(-arena.height / 2 + margin, arena.height / 2 - margin)
+        half = pillar_size / 2
+        if spawn.overlaps(x - half, y - half, x + half, y + half):
+            continue
+        arena.add_box(x, y, pillar_size, pillar_size, rng.uniform(0, 90))
+
+
+def add_segments(arena, spawn, segments):
+    """Add the walls of a grid, the collinear segments are merged so the
+    physics engine gets fewer boxes."""
+    lines = {}
+    for start, end in segments:
+        (x1, y1), (x2, y2) = start, end
+        if spawn.overlaps(min(x1, x2), min(y1, y2), max(x1, x2), max(y1, y2)):
+            continue
+        key = ("y", round(y1, 6)) if y1 == y2 else ("x", round(x1, 6))
+        span = (min(x1, x2), max(x1, x2)) if y1 == y2 else \
+            (min(y1, y2), max(y1, y2))
+        lines.setdefault(key, []).append(span)
+
+    for (axis, value), spans in sorted(lines.items()):
+        spans.sort()
+        merged = [list(spans[0])]
+        for low, high in spans[1:]:
+            if low <= merged[-1][1] + 1e-6:
+                merged[-1][1] = max(merged[-1][1], high)
+            else:
+                merged.append([low, high])
+        for low, high in merged:
+            if axis == "y":
+                arena.add_wall((low, value), (high, value))
+            else:
+                arena.add_wall((value, low), (value, high))
+
+
+def add_rooms(arena, spawn, density, rng, room_size, door):
+    """Rooms of room_size meters, with a door in the middle of each wall."""
+    columns = max(1, int(arena.width // room_size))
+    rows = max(1, int(arena.height // room_size))
+    cell_x = arena.width / columns
+    cell_y = arena.height / rows
+    left = -arena.width / 2
+    bottom = -arena.height / 2
+
+    segments = []
+    for column in range(columns):
+        for row in range(rows):
+            x = left + column * cell_x
+            y = bottom + row * cell_y
+            # Wall on the left and at the bottom of the room, with a door
+            if column > 0 and rng.random() < density:
+                gap = min(door, cell_y / 2) / 2
+                middle = y + cell_y / 2
+                segments.append(((x, y), (x, middle - gap)))
+                segments.append(((x, middle + gap), (x, y + cell_y)))
+            if row > 0 and rng.random() < density:
+                gap = min(door, cell_x / 2) / 2
+                middle = x + cell_x / 2
+                segments.append(((x, y), (middle - gap, y)))
+                segments.append(((middle + gap, y), (x + cell_x, y)))
+
+    add_segments(arena, spawn, segments)
+
+
+def add_maze(arena, spawn, density, rng, cell_size):
+    """Maze carved by a depth first search, then (1 - density) of its walls
+    are removed to open loops."""
+    columns = max(1, int(arena.width // cell_size))
+    rows = max(1, int(arena.height // cell_size))
+    cell_x = arena.width / columns
+    cell_y = arena.height / rows
+    left = -arena.width / 2
+    bottom = -arena.height / 2
+
+    # Walls on the east and north side of each cell
+    east = [[True] * rows for _ in range(columns)]
+    north = [[True] * rows for _ in range(columns)]
+    visited = [[False] * rows for _ in range(columns)]
+    stack = [(0, 0)]
+    visited[0][0] = True
+    while stack:
+        column, row = stack[-1]
+        neighbors = [(column + dx, row + dy)
+                     for dx, dy in ((1, 0), (-1, 0), (0, 1), (0, -1))
+                     if 0 <= column + dx < columns and 0 <= row + dy < rows
+                     and not visited[column + dx][row + dy]]
+        if not neighbors:
+            stack.pop()
+            continue
+        next_column, next_row = rng.choice(neighbors)
+        if next_column != column:
+            east[min(column, next_column)][row] = False
+        else:
+            north[column][min(row, next_row)] = False
+        visited[next_column][next_row] = True
+        stack.append((next_column, next_row))
+
+    segments = []
+    for column in range(columns):
+        for row in range(rows):
+            x = left + column * cell_x
+            y = bottom + row * cell_y
+            if column < columns - 1 and east[column][row] and \
+                    rng.random() < density:
+                segments.append(((x + cell_x, y), (x + cell_x, y + cell_y)))
+            if row < rows - 1 and north[column][row] and \
+                    rng.random() < density:
+                segments.append(((x, y + cell_y), (x + cell_x, y + cell_y)))
+
+    add_segments(arena, spawn, segments)
+
+
+def add_drones(arena, spawn, drones, args):
+    battery = {"model": "time_motion",
+               "delta": "{:g}".format(args.battery_delta),
+               "pos_delta": "{:g}".format(args.battery_pos_delta),
+               "orient_delta": "{:g}".format(args.battery_orient_delta)}
+    if args.start_charge is not None:
+        battery["start_charge"] = "{:g}".format(args.start_charge)
+
+    for index in range(drones):
+        x, y = spawn.position(index)
+        drone = ET.SubElement(arena.element, "crazyflie",
+                              {"id": "fly{}".format(index)})
+        ET.SubElement(drone, "body",
+                      {"position": format_vector([x, y, 0]),
+                       "orientation": "0, 0, 0"})
+        # Drones alternate between the controllers, for A/B comparisons
+        controller = args.controller[index % len(args.controller)]
+        ET.SubElement(drone, "controller", {"config": controller})
+        ET.SubElement(drone, "battery", battery)
+
+
+def generate(args):
+    tree = load(args.base)
+    root = tree.getroot()
+
+    experiment = root.find("framework").find("experiment")
+    experiment.set("length", str(args.length))
+    experiment.set("random_seed", str(args.seed))
+
+    controllers = root.find("controllers")
+    for controller in args.controller:
+        if controllers.find(".//*[@id='{}']".format(controller)) is None:
+            raise ValueError("No controller {} in {}".format(
+                controller, args.base))
+
+    loop_functions = root.find("loop_functions")
+    if loop_functions is not None:
+        if loop_functions.get("output"):
+            loop_functions.set("output", args.output_prefix)
+        if loop_functions.get("sampling_period"):
+            loop_functions.set("sampling_period", str(args.sampling_period))
+        coverage = loop_functions.find("coverage")
+        if coverage is not None and coverage.get("output"):
+            coverage.set("output", args.output_prefix)
+
+    if args.headless:
+        visualization = root.find("visualization")
+        if visualization is not None:
+            root.remove(visualization)
+
+    old_arena = root.find("arena")
+    index = list(root).index(old_arena)
+    root.remove(old_arena)
+    width, height = args.size
+    element = ET.Element(
+        "arena", {"size": format_vector([width + 1, height + 1, 2]),
+                  "center": "0, 0, 0"})
+    root.insert(index, element)
+
+    arena = Arena(element, width, height)
+    spawn = SpawnZone(arena, args.drones)
+    rng = random.Random(args.seed)
+    density = args.density if args.density is not None \
+        else DEFAULT_DENSITY[args.layout]
+
+    add_border(arena)
+    if args.layout == "pillars":
+        add_pillars(arena, spawn, density, rng)
+    elif args.layout == "rooms":
+        add_rooms(arena, spawn, density, rng, args.room_size, args.door)
+    elif args.layout == "maze":
+        add_maze(arena, spawn, density, rng, args.cell_size)
+    add_drones(arena, spawn, args.drones, args)
+
+    if hasattr(ET, "indent"):
+        ET.indent(tree, space="  ")
+    return tree, arena.boxes
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("output", help="experiment to write")
+    parser.add_argument("--base", default="experiments/golden_run.argos",
+                        help="experiment whose controllers, loop functions, "
+                             "physics engines and media are kept")
+    parser.add_argument("--controller", default=["ssc"],
+                        type=lambda value: value.split(","),
+                        help="ids of the controller configs, separated by "
+                             "commas, given to the drones in turn")
+    parser.add_argument("--size", type=parse_vector, default=[20, 20],
+                        help="width,height of the area inside the walls")
+    parser.add_argument("--layout", default="pillars",
+                        choices=sorted(DEFAULT_DENSITY))
+    parser.add_argument("--density", type=float,
+                        help="pillars: part of the area covered, rooms and "
+                             "maze: part of the walls kept")
+    parser.add_argument("--room-size", type=float, default=4.0)
+    parser.add_argument("--door", type=float, default=1.0)
+    parser.add_argument("--cell-size", type=float, default=1.5)
+    parser.add_argument("--drones", type=int, default=10)
+    parser.add_argument("--battery-delta", type=float, default=5e-4)
+    parser.add_argument("--battery-pos-delta", type=float, default=1e-3)
+    parser.add_argument("--battery-orient-delta", type=float, default=1e-3)
+    parser.add_argument("--start-charge", type=float,
+                        help="charge of the drones at the start (default: "
+                             "full)")
+    parser.add_argument("--length", type=int, default=120,
+                        help="length of the experiment, in seconds")
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("--sampling-period", type=int, default=20,
+                        help="ticks between two trajectory samples")
+    parser.add_argument("--output-prefix",
+                        help="prefix of the files written by the loop "
+                             "functions (default: output without .argos)")
+    parser.add_argument("--headless", action="store_true",
+                        help="remove the visualization of the base")
+    args = parser.parse_args()
+
+    if len(args.size) != 2 or min(args.size) <= 0:
+        parser.error("size must be width,height")
+    if args.drones < 1:
+        parser.error("drones must be at least 1")
+    if args.output_prefix is None:
+        args.output_prefix = args.output[:-6] \
+            if args.output.endswith(".argos") else args.output
+
+    try:
+        tree, boxes = generate(args)
+    except ValueError as error:
+        parser.error(str(error))
+
+    tree.write(args.output, xml_declaration=True)
+    print("{} {} drones {} boxes".format(args.output, args.drones, boxes))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,147 @@
+#!/usr/bin/env python3
+"""Split an experiment in regions, one ARGoS process per region.
+
+The arena is cut in strips along X. Each shard keeps the whole arena, adds
+walls on the borders of its strip and only spawns its part of the drones
+inside the strip. The drones of shard i are named s<i>_<id> and their servers
+use ports starting at base_port + i * port_stride, so every shard can run on
+the same host behind the gateway. The control server of shard i, which the
+gateway talks to, listens on the port just below those of its drones.
+"""
+
+import argparse
+import os
+import re
+import xml.etree.ElementTree as ET
+
+
+def parse_vector(text):
+    return [float(value) for value in text.split(",")]
+
+
+def format_vector(values):
+    return ", ".join("{:g}".format(value) for value in values)
+
+
+def load(path):
+    with open(path) as file:
+        text = file.read()
+    # ARGoS accepts unquoted numbers (port=3000), XML parsers do not
+    text = re.sub(r'(\s[\w]+)=(\d+)(?=[\s/>])', r'\1="\2"', text)
+    return ET.ElementTree(ET.fromstring(text))
+
+
+def make_shard(tree, shard, shards, args):
+    root = tree.getroot()
+    arena = root.find("arena")
+    size = parse_vector(arena.get("size"))
+    center = parse_vector(arena.get("center"))
+
+    if args.bounds:
+        low_x, high_x = args.bounds
+    else:
+        low_x = center[0] - size[0] / 2
+        high_x = center[0] + size[0] / 2
+
+    width = (high_x - low_x) / shards
+    strip_min = low_x + shard * width
+    strip_max = strip_min + width
+
+    # Walls between the strips keep the drones in their region
+    borders = []
+    if shard > 0:
+        borders.append(strip_min)
+    if shard < shards - 1:
+        borders.append(strip_max)
+    for index, x in enumerate(borders):
+        wall = ET.SubElement(
+            arena, "box",
+            {"id": "shard_wall_{}".format(index),
+             "size": format_vector([0.001, size[1], size[2]]),
+             "movable": "false"})
+        ET.SubElement(
+            wall, "body",
+            {"position": format_vector([x, center[1], 0]),
+             "orientation": "0, 0, 0"})
+
+    margin = min(0.2, width / 4)
+    for distribute in arena.findall("distribute"):
+        entity = distribute.find("entity")
+        drone = entity.find("crazyflie") if entity is not None else None
+        if drone is None:
+            continue
+
+        total = int(entity.get("quantity"))
+        quantity = total // shards + (1 if shard < total % shards else 0)
+        entity.set("quantity", str(quantity))
+        drone.set("id", "s{}_{}".format(shard, drone.get("id")))
+
+        position = distribute.find("position")
+        low = parse_vector(position.get("min"))
+        high = parse_vector(position.get("max"))
+        low[0] = strip_min + margin
+        high[0] = strip_max - margin
+        position.set("min", format_vector(low))
+        position.set("max", format_vector(high))
+
+    for controller in root.find("controllers"):
+        params = controller.find("params")
+        if params is None:
+            params = ET.SubElement(controller, "params")
+        params.set(
+            "base_port", str(args.base_port + shard * args.port_stride))
+
+    loop_functions = root.find("loop_functions")
+    if loop_functions is not None:
+        control = loop_functions.find("control")
+        if control is None:
+            control = ET.SubElement(loop_functions, "control")
+        control.set("port", str(control_port(shard, args)))
+
+        coverage = loop_functions.find("coverage")
+        if coverage is not None and coverage.get("output"):
+            coverage.set(
+                "output", "{}_s{}".format(coverage.get("output"), shard))
+
+    visualization = root.find("visualization")
+    if visualization is not None:
+        webviz = visualization.find("webviz")
+        if webviz is not None and webviz.get("port"):
+            webviz.set("port", str(int(webviz.get("port")) + shard))
+
+
+def control_port(shard, args):
+    return args.base_port + shard * args.port_stride - 1
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("config", help="experiment to split")
+    parser.add_argument("shards", type=int, help="number of regions")
+    parser.add_argument("--output", default="shards",
+                        help="directory of the shard experiments")
+    parser.add_argument("--base-port", type=int, default=9854)
+    parser.add_argument("--port-stride", type=int, default=1000)
+    parser.add_argument("--bounds", type=parse_vector,
+                        help="min,max along X of the area to split "
+                             "(default: the whole arena)")
+    args = parser.parse_args()
+
+    if args.shards < 1:
+        parser.error("shards must be at least 1")
+    if args.bounds and len(args.bounds) != 2:
+        parser.error("bounds must be min,max")
+
+    os.makedirs(args.output, exist_ok=True)
+    for shard in range(args.shards):
+        tree = load(args.config)
+        make_shard(tree, shard, args.shards, args)
+        if hasattr(ET, "indent"):
+            ET.indent(tree, space="  ")
+        path = os.path.join(args.output, "shard_{}.argos".format(shard))
+        tree.write(path, xml_declaration=True)
+        print("{} {}".format(path, control_port(shard, args)))
+
+
+if __name__ == "__main__":
+    main()